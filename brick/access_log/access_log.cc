@@ -0,0 +1,280 @@
+#include "access_log.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <new>
+
+#include "brick/utils/logging/logger.hpp"
+
+namespace brick {
+
+namespace {
+
+// how often the background thread looks for segments to seal or prepare
+constexpr std::chrono::milliseconds kRotateInterval{50};
+constexpr size_t kPageSize = 4096;
+// smallest useful segment, in records
+constexpr size_t kMinRecords = 1024;
+
+int64_t wall_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+}  // namespace
+
+std::unique_ptr<AccessLog> AccessLog::open(
+    const AccessLogOptions& options, size_t workers,
+    const std::vector<std::string>& routes) {
+    if (mkdir(options.directory.c_str(), 0755) < 0 && errno != EEXIST) {
+        log::error("Could not create access log directory ",
+                   options.directory, ": ", strerror(errno));
+        return nullptr;
+    }
+
+    std::unique_ptr<AccessLog> access_log(
+        new AccessLog(options, workers, routes));
+
+    // the first segments are made here, so a bad directory fails the start
+    for (size_t i = 0; i < workers; i++) {
+        Writer& writer = access_log->writers_[i];
+        writer.current = access_log->create_segment(i);
+        if (writer.current == nullptr) {
+            return nullptr;
+        }
+        writer.started_ns = wall_ns();
+    }
+
+    access_log->thread_ =
+        std::thread(&AccessLog::rotate_segments, access_log.get());
+    return access_log;
+}
+
+AccessLog::AccessLog(const AccessLogOptions& options, size_t workers,
+                     const std::vector<std::string>& routes)
+    : options_(options),
+      route_count_(static_cast<uint32_t>(routes.size())),
+      writers_(std::make_unique<Writer[]>(workers)),
+      workers_(workers) {
+    for (const std::string& route : routes) {
+        routes_ += route;
+        routes_ += '\0';
+    }
+    records_offset_ = (sizeof(access_log::SegmentHeader) + routes_.size() +
+                       kPageSize - 1) /
+                      kPageSize * kPageSize;
+    options_.segment_size =
+        std::max(options_.segment_size,
+                 records_offset_ + kMinRecords * sizeof(access_log::Record));
+
+    char started[32];
+    time_t now = time(nullptr);
+    struct tm tm;
+    gmtime_r(&now, &tm);
+    strftime(started, sizeof(started), "%Y%m%dT%H%M%SZ", &tm);
+    name_base_ = options_.directory + "/" + options_.prefix + "-" + started +
+                 "-" + std::to_string(getpid()) + "-w";
+}
+
+AccessLog::~AccessLog() {
+    if (thread_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_one();
+        thread_.join();
+    }
+
+    for (size_t i = 0; i < workers_; i++) {
+        Writer& writer = writers_[i];
+        for (Segment* segment :
+             {writer.full.load(), writer.current, writer.spare.load()}) {
+            if (segment != nullptr) seal_segment(segment);
+        }
+        if (writer.dropped > 0) {
+            log::warning("Access log dropped ", writer.dropped.load(),
+                         " records of worker ", i,
+                         " (segment rotation fell behind)");
+        }
+    }
+}
+
+void AccessLog::append(size_t worker, const access_log::Record& record) {
+    Writer& writer = writers_[worker];
+    uint64_t capacity = writer.current->header->capacity;
+
+    if (writer.count == capacity ||
+        writer.rotate.load(std::memory_order_relaxed)) {
+        if (!swap_segment(writer, record.timestamp_ns) &&
+            writer.count == capacity) {
+            writer.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    writer.current->records[writer.count++] = record;
+    // readers of a live segment only trust records below `count`
+    writer.current->header->count.store(writer.count,
+                                        std::memory_order_release);
+}
+
+uint64_t AccessLog::dropped() const {
+    uint64_t dropped = 0;
+    for (size_t i = 0; i < workers_; i++) {
+        dropped += writers_[i].dropped.load(std::memory_order_relaxed);
+    }
+    return dropped;
+}
+
+bool AccessLog::swap_segment(Writer& writer, int64_t now) {
+    // an old but still empty segment is just kept
+    if (writer.count == 0) {
+        writer.started_ns.store(now, std::memory_order_relaxed);
+        writer.rotate.store(false, std::memory_order_relaxed);
+        return true;
+    }
+
+    // the previous segment must be sealed first: there is one handoff slot
+    if (writer.full.load(std::memory_order_acquire) != nullptr) {
+        return false;
+    }
+    Segment* next = writer.spare.exchange(nullptr, std::memory_order_acquire);
+    if (next == nullptr) {
+        return false;
+    }
+
+    writer.full.store(writer.current, std::memory_order_release);
+    writer.current = next;
+    writer.count = 0;
+    writer.started_ns.store(now, std::memory_order_relaxed);
+    writer.rotate.store(false, std::memory_order_relaxed);
+    return true;
+}
+
+AccessLog::Segment* AccessLog::create_segment(size_t worker) {
+    Writer& writer = writers_[worker];
+    uint32_t sequence = writer.sequence++;
+
+    auto segment = std::make_unique<Segment>();
+    segment->size = options_.segment_size;
+    segment->path = name_base_ + std::to_string(worker) + "-" +
+                    std::to_string(sequence) + ".alog.open";
+
+    segment->fd = ::open(segment->path.c_str(),
+                         O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (segment->fd < 0) {
+        log::error("Could not create access log segment ", segment->path,
+                   ": ", strerror(errno));
+        return nullptr;
+    }
+
+    // allocate the blocks now: running out of disk later would be a SIGBUS
+    // on the hot path instead of an error here
+    int error = posix_fallocate(segment->fd, 0,
+                                static_cast<off_t>(segment->size));
+    if (error == 0) {
+        segment->base = mmap(nullptr, segment->size, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, segment->fd, 0);
+        if (segment->base == MAP_FAILED) {
+            segment->base = nullptr;
+            error = errno;
+        }
+    }
+    if (error != 0) {
+        log::error("Could not allocate access log segment ", segment->path,
+                   ": ", strerror(error));
+        close(segment->fd);
+        unlink(segment->path.c_str());
+        return nullptr;
+    }
+
+    auto* header = new (segment->base) access_log::SegmentHeader();
+    memcpy(header->magic, access_log::kMagic, sizeof(header->magic));
+    header->version = access_log::kVersion;
+    header->record_size = sizeof(access_log::Record);
+    header->worker = static_cast<uint32_t>(worker);
+    header->sequence = sequence;
+    header->records_offset = records_offset_;
+    header->capacity =
+        (segment->size - records_offset_) / sizeof(access_log::Record);
+    header->created_ns = wall_ns();
+    header->route_count = route_count_;
+    header->routes_size = static_cast<uint32_t>(routes_.size());
+    memcpy(static_cast<char*>(segment->base) + sizeof(*header),
+           routes_.data(), routes_.size());
+
+    segment->header = header;
+    segment->records = reinterpret_cast<access_log::Record*>(
+        static_cast<char*>(segment->base) + records_offset_);
+    return segment.release();
+}
+
+void AccessLog::seal_segment(Segment* segment) {
+    std::unique_ptr<Segment> owned(segment);
+    uint64_t count = segment->header->count.load(std::memory_order_acquire);
+    segment->header->sealed = 1;
+    munmap(segment->base, segment->size);
+
+    if (count == 0) {
+        unlink(segment->path.c_str());
+    } else {
+        // drop the unused preallocated tail
+        if (ftruncate(segment->fd,
+                      static_cast<off_t>(records_offset_ +
+                                         count * sizeof(access_log::Record))) <
+            0) {
+            log::warning("Could not truncate access log segment ",
+                         segment->path, ": ", strerror(errno));
+        }
+        std::string sealed =
+            segment->path.substr(0, segment->path.size() - 5);  // ".open"
+        if (rename(segment->path.c_str(), sealed.c_str()) < 0) {
+            log::warning("Could not rename access log segment ",
+                         segment->path, ": ", strerror(errno));
+        }
+    }
+    close(segment->fd);
+}
+
+void AccessLog::rotate_segments() {
+    int64_t max_age =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            options_.max_segment_age)
+            .count();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        int64_t now = wall_ns();
+        for (size_t i = 0; i < workers_; i++) {
+            Writer& writer = writers_[i];
+
+            Segment* full = writer.full.load(std::memory_order_acquire);
+            if (full != nullptr) {
+                seal_segment(full);
+                writer.full.store(nullptr, std::memory_order_release);
+            }
+            // a failed create is retried on the next round
+            if (writer.spare.load(std::memory_order_acquire) == nullptr) {
+                writer.spare.store(create_segment(i),
+                                   std::memory_order_release);
+            }
+            if (max_age > 0 &&
+                now - writer.started_ns.load(std::memory_order_relaxed) >
+                    max_age) {
+                writer.rotate.store(true, std::memory_order_relaxed);
+            }
+        }
+        wake_.wait_for(lock, kRotateInterval, [this] { return stopping_; });
+    }
+}
+
+}  // namespace brick
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "brick/access_log/format.hpp"
+
+namespace brick {
+
+struct AccessLogOptions {
+    // directory the segment files are written to (created if missing)
+    std::string directory;
+    // segment file names start with this
+    std::string prefix = "access";
+    // bytes per segment file, preallocated up front
+    size_t segment_size = 64 << 20;
+    // segments are also rotated once this old (0 to rotate only when full)
+    std::chrono::seconds max_segment_age{3600};
+};
+
+/**
+ * Binary access log: each worker appends fixed-size records (see
+ * format.hpp) to its own memory-mapped segment file.
+ *
+ * Appending is a copy into the mapping - no locks, no syscalls, no
+ * formatting. Segment files are created, preallocated and mapped ahead of
+ * time by a background thread, which also seals the segments workers have
+ * filled; a worker switches to its next segment by swapping a pointer. If
+ * the background thread falls behind and a worker fills its segment before
+ * the next one is ready, records are dropped (and counted) rather than
+ * blocking the worker.
+ *
+ * Use tools/access_log_dump to turn segments into text or CSV.
+ */
+class AccessLog {
+   public:
+    /**
+     * @brief Create the first segment of every worker and start the
+     * background thread
+     * @param `options` where and how to write segments
+     * @param `workers` number of worker threads (valid `append` indices)
+     * @param `routes` route table written to every segment; route id N is
+     * `routes[N - 1]`
+     * @return the log, or nullptr on failure (errors are logged)
+     */
+    static std::unique_ptr<AccessLog> open(
+        const AccessLogOptions& options, size_t workers,
+        const std::vector<std::string>& routes);
+
+    /**
+     * @brief Stop the background thread and seal every segment; workers
+     * must have stopped appending
+     */
+    ~AccessLog();
+    AccessLog(const AccessLog&) = delete;
+    AccessLog& operator=(const AccessLog&) = delete;
+
+    /**
+     * @brief Append a record to a worker's segment
+     * @param `worker` index of the calling worker; each index must only be
+     * used by one thread at a time
+     * @param `record` the record
+     */
+    void append(size_t worker, const access_log::Record& record);
+
+    /**
+     * @brief Records dropped so far, over all workers, because a worker's
+     * next segment was not ready in time
+     */
+    uint64_t dropped() const;
+
+   private:
+    struct Segment {
+        int fd = -1;
+        void* base = nullptr;
+        size_t size = 0;
+        access_log::SegmentHeader* header = nullptr;
+        access_log::Record* records = nullptr;
+        // while open, ending in ".open"
+        std::string path;
+    };
+
+    // padded so workers never share a cache line
+    struct alignas(64) Writer {
+        // only touched by the worker
+        Segment* current = nullptr;
+        uint64_t count = 0;
+
+        // handed between the worker and the background thread: the next
+        // segment, ready to use, and a filled one waiting to be sealed
+        std::atomic<Segment*> spare = nullptr;
+        std::atomic<Segment*> full = nullptr;
+        // set by the background thread when `current` is too old
+        std::atomic<bool> rotate = false;
+        // when `current` was started (wall clock, ns)
+        std::atomic<int64_t> started_ns = 0;
+        std::atomic<uint64_t> dropped = 0;
+
+        // only touched by the background thread
+        uint32_t sequence = 0;
+    };
+
+    AccessLog(const AccessLogOptions& options, size_t workers,
+              const std::vector<std::string>& routes);
+
+    bool swap_segment(Writer& writer, int64_t now);
+    Segment* create_segment(size_t worker);
+    void seal_segment(Segment* segment);
+    void rotate_segments();
+
+    AccessLogOptions options_;
+    // NUL-separated route names, and where records start in every segment
+    std::string routes_;
+    uint32_t route_count_;
+    size_t records_offset_;
+    // file names: prefix-<start time>-<pid>-w<worker>-<sequence>.alog
+    std::string name_base_;
+
+    std::unique_ptr<Writer[]> writers_;
+    size_t workers_;
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+};
+
+}  // namespace brick
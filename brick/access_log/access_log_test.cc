@@ -0,0 +1,168 @@
+#include "brick/access_log/access_log.hpp"
+
+#include <dirent.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace brick {
+namespace {
+
+// records per segment: the smallest segment `AccessLog` allows
+constexpr uint64_t kCapacity = 1024;
+
+const std::vector<std::string> kRoutes = {"GET /", "POST /items"};
+
+// the `i`-th record appended
+access_log::Record record(uint64_t i) {
+    access_log::Record record = {};
+    record.timestamp_ns = static_cast<int64_t>(1000 + i);
+    record.request_id = i;
+    record.bytes = i * 10;
+    record.route = static_cast<uint32_t>(i % (kRoutes.size() + 1));
+    record.latency_us = static_cast<uint32_t>(i % 100);
+    record.status = i % 2 == 0 ? 200 : 404;
+    record.method = i % 2 == 0 ? access_log::Method::kGet
+                               : access_log::Method::kPost;
+    record.flags = access_log::kTls;
+    return record;
+}
+
+class AccessLogTest : public ::testing::Test {
+   protected:
+    AccessLogTest() {
+        char dir[] = "/tmp/brick_access_log_test.XXXXXX";
+        EXPECT_NE(mkdtemp(dir), nullptr);
+        options_.directory = dir;
+        // far below the minimum, which is what it gets instead
+        options_.segment_size = 1;
+        options_.max_segment_age = std::chrono::seconds(0);
+    }
+
+    ~AccessLogTest() override {
+        for (const std::string& name : files()) {
+            unlink((options_.directory + "/" + name).c_str());
+        }
+        rmdir(options_.directory.c_str());
+    }
+
+    // names in the log directory, sorted (by sequence, for one worker)
+    std::vector<std::string> files() const {
+        std::vector<std::string> names;
+        DIR* dir = opendir(options_.directory.c_str());
+        if (dir == nullptr) return names;
+        while (struct dirent* entry = readdir(dir)) {
+            if (entry->d_name[0] != '.') names.push_back(entry->d_name);
+        }
+        closedir(dir);
+        std::sort(names.begin(), names.end());
+        return names;
+    }
+
+    // a whole file, in a buffer aligned for the header
+    std::vector<uint64_t> read(const std::string& name, size_t* size) const {
+        std::ifstream file(options_.directory + "/" + name,
+                           std::ios::binary);
+        std::string bytes((std::istreambuf_iterator<char>(file)),
+                          std::istreambuf_iterator<char>());
+        *size = bytes.size();
+        std::vector<uint64_t> buffer((bytes.size() + 7) / 8);
+        memcpy(buffer.data(), bytes.data(), bytes.size());
+        return buffer;
+    }
+
+    AccessLogOptions options_;
+};
+
+TEST_F(AccessLogTest, WritesSealedSegments) {
+    constexpr uint64_t kRecords = 2 * kCapacity + 100;
+    {
+        auto log = AccessLog::open(options_, 1, kRoutes);
+        ASSERT_NE(log, nullptr);
+        for (uint64_t i = 0; i < kRecords; i++) {
+            // give the background thread time to seal the last segment and
+            // prepare the next one
+            if (i % kCapacity == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            }
+            log->append(0, record(i));
+        }
+        EXPECT_EQ(log->dropped(), 0);
+    }
+
+    // sealed, and the unused spare removed
+    std::vector<std::string> names = files();
+    ASSERT_EQ(names.size(), 3);
+    uint64_t next = 0;
+    for (uint32_t sequence = 0; sequence < names.size(); sequence++) {
+        const std::string& name = names[sequence];
+        SCOPED_TRACE(name);
+        EXPECT_EQ(name.substr(0, 7), "access-");
+        EXPECT_TRUE(name.ends_with("-w0-" + std::to_string(sequence) +
+                                   ".alog"));
+
+        size_t size;
+        std::vector<uint64_t> buffer = read(name, &size);
+        ASSERT_GE(size, sizeof(access_log::SegmentHeader));
+        const char* base = reinterpret_cast<const char*>(buffer.data());
+        const auto* header =
+            reinterpret_cast<const access_log::SegmentHeader*>(base);
+        EXPECT_EQ(memcmp(header->magic, access_log::kMagic,
+                         sizeof(header->magic)),
+                  0);
+        EXPECT_EQ(header->version, access_log::kVersion);
+        EXPECT_EQ(header->record_size, sizeof(access_log::Record));
+        EXPECT_EQ(header->worker, 0);
+        EXPECT_EQ(header->sequence, sequence);
+        EXPECT_EQ(header->capacity, kCapacity);
+        EXPECT_EQ(header->sealed, 1);
+
+        // the route table, right after the header
+        EXPECT_EQ(header->route_count, kRoutes.size());
+        EXPECT_EQ(std::string(base + sizeof(*header), header->routes_size),
+                  std::string("GET /\0POST /items\0", 18));
+
+        // the records, and nothing past them
+        uint64_t count = header->count.load();
+        EXPECT_EQ(count, std::min(kCapacity, kRecords - next));
+        EXPECT_EQ(header->records_offset % 4096, 0);
+        ASSERT_EQ(size, header->records_offset +
+                            count * sizeof(access_log::Record));
+        const auto* records = reinterpret_cast<const access_log::Record*>(
+            base + header->records_offset);
+        for (uint64_t i = 0; i < count; i++, next++) {
+            access_log::Record expected = record(next);
+            ASSERT_EQ(memcmp(&records[i], &expected, sizeof(expected)), 0)
+                << next;
+        }
+    }
+    EXPECT_EQ(next, kRecords);
+}
+
+TEST_F(AccessLogTest, RemovesEmptySegments) {
+    {
+        auto log = AccessLog::open(options_, 2, kRoutes);
+        ASSERT_NE(log, nullptr);
+        log->append(1, record(0));
+    }
+    std::vector<std::string> names = files();
+    ASSERT_EQ(names.size(), 1);
+    EXPECT_TRUE(names[0].ends_with("-w1-0.alog"));
+}
+
+TEST_F(AccessLogTest, FailsOnUnusableDirectory) {
+    AccessLogOptions options = options_;
+    options.directory = "/nonexistent/brick/access_log";
+    EXPECT_EQ(AccessLog::open(options, 1, kRoutes), nullptr);
+}
+
+}  // namespace
+}  // namespace brick
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+
+/**
+ * On-disk layout of access-log segment files, shared by the writer
+ * (`AccessLog`) and the offline reader (tools/access_log_dump).
+ *
+ * A segment is a `SegmentHeader`, the route table (route names as
+ * "METHOD /path", each NUL-terminated; route id N is the N-th name), and,
+ * from `records_offset` on, `count` fixed-size `Record`s. Segments are
+ * written in place through a shared mapping, so `count` is kept up to date
+ * as records are appended: a segment that is still open, or whose writer
+ * crashed, can be read as well. Segments being written end in ".open"; the
+ * suffix is dropped, and the file truncated to its records, once the segment
+ * is sealed.
+ *
+ * Numbers are in host byte order; segments are meant to be read on the
+ * machine (or at least the architecture) that wrote them.
+ */
+
+namespace brick::access_log {
+
+inline constexpr char kMagic[8] = {'B', 'R', 'I', 'C', 'K', 'L', 'O', 'G'};
+inline constexpr uint32_t kVersion = 1;
+
+enum class Method : uint8_t {
+    kOther,
+    kGet,
+    kHead,
+    kPost,
+    kPut,
+    kDelete,
+    kPatch,
+    kOptions,
+    kConnect,
+    kTrace,
+};
+
+// `Record::flags`
+enum Flags : uint8_t {
+    kTls = 1 << 0,
+    kHttp2 = 1 << 1,
+    kProxied = 1 << 2,
+    // the response was cut short (the connection failed halfway through)
+    kTruncated = 1 << 3,
+};
+
+/**
+ * @brief One request; a record fills exactly one cache line
+ */
+struct Record {
+    // when the response was queued (wall clock, ns since the epoch)
+    int64_t timestamp_ns;
+    uint64_t request_id;
+    // client IPv6 address (IPv4 clients as v4-mapped addresses); all zero
+    // for Unix socket clients
+    uint8_t peer[16];
+    // response body bytes (for proxied requests: relayed from the upstream)
+    uint64_t bytes;
+    // index + 1 in the segment's route table, or 0 for unregistered routes
+    uint32_t route;
+    // from the start of handling to the response being queued
+    uint32_t latency_us;
+    uint16_t status;
+    Method method;
+    uint8_t flags;
+    uint8_t reserved[12];
+};
+static_assert(sizeof(Record) == 64);
+
+struct SegmentHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t worker;
+    uint32_t sequence;
+    // where the records start (page aligned), and how many fit
+    uint64_t records_offset;
+    uint64_t capacity;
+    // when the segment was created (wall clock, ns since the epoch)
+    int64_t created_ns;
+    // records written so far
+    std::atomic<uint64_t> count;
+    // route names, right after the header
+    uint32_t route_count;
+    uint32_t routes_size;
+    // set once the writer is done with the segment
+    uint32_t sealed;
+    uint32_t reserved;
+};
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+/**
+ * @brief Map a request method to its code
+ */
+inline Method parse_method(std::string_view method) {
+    if (method == "GET") return Method::kGet;
+    if (method == "HEAD") return Method::kHead;
+    if (method == "POST") return Method::kPost;
+    if (method == "PUT") return Method::kPut;
+    if (method == "DELETE") return Method::kDelete;
+    if (method == "PATCH") return Method::kPatch;
+    if (method == "OPTIONS") return Method::kOptions;
+    if (method == "CONNECT") return Method::kConnect;
+    if (method == "TRACE") return Method::kTrace;
+    return Method::kOther;
+}
+
+/**
+ * @brief Name of a method code ("-" for `kOther` and unknown codes)
+ */
+inline std::string_view method_name(Method method) {
+    static constexpr std::string_view kNames[] = {
+        "-",     "GET",   "HEAD",    "POST",    "PUT",
+        "DELETE", "PATCH", "OPTIONS", "CONNECT", "TRACE"};
+    size_t index = static_cast<size_t>(method);
+    return index < std::size(kNames) ? kNames[index] : "-";
+}
+
+}  // namespace brick::access_log
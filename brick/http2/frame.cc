@@ -0,0 +1,41 @@
+#include "frame.hpp"
+
+namespace brick::http2 {
+
+bool parse_frame_header(std::string_view in, FrameHeader* header) {
+    if (in.size() < kFrameHeaderSize) return false;
+
+    const auto* bytes = reinterpret_cast<const uint8_t*>(in.data());
+    header->length = (bytes[0] << 16) | (bytes[1] << 8) | bytes[2];
+    header->type = static_cast<FrameType>(bytes[3]);
+    header->flags = bytes[4];
+    header->stream_id = read_u31(in.substr(5));
+    return true;
+}
+
+void write_frame(FrameType type, uint8_t flags, uint32_t stream_id,
+                 std::string_view payload, std::string* out) {
+    size_t length = payload.size();
+    out->push_back(static_cast<char>(length >> 16));
+    out->push_back(static_cast<char>(length >> 8));
+    out->push_back(static_cast<char>(length));
+    out->push_back(static_cast<char>(type));
+    out->push_back(static_cast<char>(flags));
+    write_u32(stream_id, out);
+    out->append(payload);
+}
+
+uint32_t read_u32(std::string_view in) {
+    const auto* bytes = reinterpret_cast<const uint8_t*>(in.data());
+    return (static_cast<uint32_t>(bytes[0]) << 24) | (bytes[1] << 16) |
+           (bytes[2] << 8) | bytes[3];
+}
+
+void write_u32(uint32_t value, std::string* out) {
+    out->push_back(static_cast<char>(value >> 24));
+    out->push_back(static_cast<char>(value >> 16));
+    out->push_back(static_cast<char>(value >> 8));
+    out->push_back(static_cast<char>(value));
+}
+
+}  // namespace brick::http2
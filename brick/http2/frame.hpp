@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * HTTP/2 framing layer (RFC 9113 section 4): frame types, flags, error codes
+ * and the 9-byte frame header.
+ */
+
+namespace brick::http2 {
+
+enum class FrameType : uint8_t {
+    kData = 0x0,
+    kHeaders = 0x1,
+    kPriority = 0x2,
+    kRstStream = 0x3,
+    kSettings = 0x4,
+    kPushPromise = 0x5,
+    kPing = 0x6,
+    kGoAway = 0x7,
+    kWindowUpdate = 0x8,
+    kContinuation = 0x9,
+};
+
+namespace flags {
+constexpr uint8_t kEndStream = 0x1;
+constexpr uint8_t kAck = 0x1;
+constexpr uint8_t kEndHeaders = 0x4;
+constexpr uint8_t kPadded = 0x8;
+constexpr uint8_t kPriority = 0x20;
+}  // namespace flags
+
+enum class ErrorCode : uint32_t {
+    kNoError = 0x0,
+    kProtocolError = 0x1,
+    kInternalError = 0x2,
+    kFlowControlError = 0x3,
+    kSettingsTimeout = 0x4,
+    kStreamClosed = 0x5,
+    kFrameSizeError = 0x6,
+    kRefusedStream = 0x7,
+    kCancel = 0x8,
+    kCompressionError = 0x9,
+    kConnectError = 0xa,
+    kEnhanceYourCalm = 0xb,
+    kInadequateSecurity = 0xc,
+    kHttp11Required = 0xd,
+};
+
+enum class Setting : uint16_t {
+    kHeaderTableSize = 0x1,
+    kEnablePush = 0x2,
+    kMaxConcurrentStreams = 0x3,
+    kInitialWindowSize = 0x4,
+    kMaxFrameSize = 0x5,
+    kMaxHeaderListSize = 0x6,
+};
+
+constexpr size_t kFrameHeaderSize = 9;
+// SETTINGS_MAX_FRAME_SIZE default (and the largest frame we accept)
+constexpr uint32_t kDefaultMaxFrameSize = 16384;
+// SETTINGS_INITIAL_WINDOW_SIZE default, also the initial connection window
+constexpr int64_t kDefaultWindow = 65535;
+constexpr int64_t kMaxWindow = 0x7FFFFFFF;
+
+constexpr std::string_view kClientPreface = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+struct FrameHeader {
+    uint32_t length;
+    FrameType type;
+    uint8_t flags;
+    uint32_t stream_id;
+};
+
+/**
+ * @brief Parse a frame header from the start of `in`
+ * @return false if fewer than `kFrameHeaderSize` bytes are available
+ */
+bool parse_frame_header(std::string_view in, FrameHeader* header);
+
+/**
+ * @brief Append a frame (header and payload) to `out`
+ */
+void write_frame(FrameType type, uint8_t flags, uint32_t stream_id,
+                 std::string_view payload, std::string* out);
+
+/**
+ * @brief Read a big-endian 32-bit integer
+ */
+uint32_t read_u32(std::string_view in);
+
+/**
+ * @brief Read a big-endian 31-bit integer (stream ids, window increments),
+ * ignoring the reserved high bit
+ */
+inline uint32_t read_u31(std::string_view in) {
+    return read_u32(in) & 0x7FFFFFFF;
+}
+
+/**
+ * @brief Append a big-endian 32-bit integer
+ */
+void write_u32(uint32_t value, std::string* out);
+
+}  // namespace brick::http2
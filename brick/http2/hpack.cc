@@ -0,0 +1,425 @@
+#include "hpack.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+namespace brick::http2 {
+
+namespace {
+
+const Header kStaticTable[] = {
+    {":authority", ""},
+    {":method", "GET"},
+    {":method", "POST"},
+    {":path", "/"},
+    {":path", "/index.html"},
+    {":scheme", "http"},
+    {":scheme", "https"},
+    {":status", "200"},
+    {":status", "204"},
+    {":status", "206"},
+    {":status", "304"},
+    {":status", "400"},
+    {":status", "404"},
+    {":status", "500"},
+    {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"},
+    {"accept-language", ""},
+    {"accept-ranges", ""},
+    {"accept", ""},
+    {"access-control-allow-origin", ""},
+    {"age", ""},
+    {"allow", ""},
+    {"authorization", ""},
+    {"cache-control", ""},
+    {"content-disposition", ""},
+    {"content-encoding", ""},
+    {"content-language", ""},
+    {"content-length", ""},
+    {"content-location", ""},
+    {"content-range", ""},
+    {"content-type", ""},
+    {"cookie", ""},
+    {"date", ""},
+    {"etag", ""},
+    {"expect", ""},
+    {"expires", ""},
+    {"from", ""},
+    {"host", ""},
+    {"if-match", ""},
+    {"if-modified-since", ""},
+    {"if-none-match", ""},
+    {"if-range", ""},
+    {"if-unmodified-since", ""},
+    {"last-modified", ""},
+    {"link", ""},
+    {"location", ""},
+    {"max-forwards", ""},
+    {"proxy-authenticate", ""},
+    {"proxy-authorization", ""},
+    {"range", ""},
+    {"referer", ""},
+    {"refresh", ""},
+    {"retry-after", ""},
+    {"server", ""},
+    {"set-cookie", ""},
+    {"strict-transport-security", ""},
+    {"transfer-encoding", ""},
+    {"user-agent", ""},
+    {"vary", ""},
+    {"via", ""},
+    {"www-authenticate", ""},
+};
+constexpr size_t kStaticSize = sizeof(kStaticTable) / sizeof(kStaticTable[0]);
+
+// per-entry overhead counted against the table size (RFC 7541 4.1)
+constexpr size_t kEntryOverhead = 32;
+
+// canonical Huffman code for each byte value (RFC 7541 Appendix B)
+struct HuffmanCode {
+    uint32_t code;
+    uint8_t bits;
+};
+const HuffmanCode kHuffmanCodes[256] = {
+    {0x1ff8, 13}, {0x7fffd8, 23}, {0xfffffe2, 28}, {0xfffffe3, 28},
+    {0xfffffe4, 28}, {0xfffffe5, 28}, {0xfffffe6, 28}, {0xfffffe7, 28},
+    {0xfffffe8, 28}, {0xffffea, 24}, {0x3ffffffc, 30}, {0xfffffe9, 28},
+    {0xfffffea, 28}, {0x3ffffffd, 30}, {0xfffffeb, 28}, {0xfffffec, 28},
+    {0xfffffed, 28}, {0xfffffee, 28}, {0xfffffef, 28}, {0xffffff0, 28},
+    {0xffffff1, 28}, {0xffffff2, 28}, {0x3ffffffe, 30}, {0xffffff3, 28},
+    {0xffffff4, 28}, {0xffffff5, 28}, {0xffffff6, 28}, {0xffffff7, 28},
+    {0xffffff8, 28}, {0xffffff9, 28}, {0xffffffa, 28}, {0xffffffb, 28},
+    {0x14, 6}, {0x3f8, 10}, {0x3f9, 10}, {0xffa, 12},
+    {0x1ff9, 13}, {0x15, 6}, {0xf8, 8}, {0x7fa, 11},
+    {0x3fa, 10}, {0x3fb, 10}, {0xf9, 8}, {0x7fb, 11},
+    {0xfa, 8}, {0x16, 6}, {0x17, 6}, {0x18, 6},
+    {0x0, 5}, {0x1, 5}, {0x2, 5}, {0x19, 6},
+    {0x1a, 6}, {0x1b, 6}, {0x1c, 6}, {0x1d, 6},
+    {0x1e, 6}, {0x1f, 6}, {0x5c, 7}, {0xfb, 8},
+    {0x7ffc, 15}, {0x20, 6}, {0xffb, 12}, {0x3fc, 10},
+    {0x1ffa, 13}, {0x21, 6}, {0x5d, 7}, {0x5e, 7},
+    {0x5f, 7}, {0x60, 7}, {0x61, 7}, {0x62, 7},
+    {0x63, 7}, {0x64, 7}, {0x65, 7}, {0x66, 7},
+    {0x67, 7}, {0x68, 7}, {0x69, 7}, {0x6a, 7},
+    {0x6b, 7}, {0x6c, 7}, {0x6d, 7}, {0x6e, 7},
+    {0x6f, 7}, {0x70, 7}, {0x71, 7}, {0x72, 7},
+    {0xfc, 8}, {0x73, 7}, {0xfd, 8}, {0x1ffb, 13},
+    {0x7fff0, 19}, {0x1ffc, 13}, {0x3ffc, 14}, {0x22, 6},
+    {0x7ffd, 15}, {0x3, 5}, {0x23, 6}, {0x4, 5},
+    {0x24, 6}, {0x5, 5}, {0x25, 6}, {0x26, 6},
+    {0x27, 6}, {0x6, 5}, {0x74, 7}, {0x75, 7},
+    {0x28, 6}, {0x29, 6}, {0x2a, 6}, {0x7, 5},
+    {0x2b, 6}, {0x76, 7}, {0x2c, 6}, {0x8, 5},
+    {0x9, 5}, {0x2d, 6}, {0x77, 7}, {0x78, 7},
+    {0x79, 7}, {0x7a, 7}, {0x7b, 7}, {0x7ffe, 15},
+    {0x7fc, 11}, {0x3ffd, 14}, {0x1ffd, 13}, {0xffffffc, 28},
+    {0xfffe6, 20}, {0x3fffd2, 22}, {0xfffe7, 20}, {0xfffe8, 20},
+    {0x3fffd3, 22}, {0x3fffd4, 22}, {0x3fffd5, 22}, {0x7fffd9, 23},
+    {0x3fffd6, 22}, {0x7fffda, 23}, {0x7fffdb, 23}, {0x7fffdc, 23},
+    {0x7fffdd, 23}, {0x7fffde, 23}, {0xffffeb, 24}, {0x7fffdf, 23},
+    {0xffffec, 24}, {0xffffed, 24}, {0x3fffd7, 22}, {0x7fffe0, 23},
+    {0xffffee, 24}, {0x7fffe1, 23}, {0x7fffe2, 23}, {0x7fffe3, 23},
+    {0x7fffe4, 23}, {0x1fffdc, 21}, {0x3fffd8, 22}, {0x7fffe5, 23},
+    {0x3fffd9, 22}, {0x7fffe6, 23}, {0x7fffe7, 23}, {0xffffef, 24},
+    {0x3fffda, 22}, {0x1fffdd, 21}, {0xfffe9, 20}, {0x3fffdb, 22},
+    {0x3fffdc, 22}, {0x7fffe8, 23}, {0x7fffe9, 23}, {0x1fffde, 21},
+    {0x7fffea, 23}, {0x3fffdd, 22}, {0x3fffde, 22}, {0xfffff0, 24},
+    {0x1fffdf, 21}, {0x3fffdf, 22}, {0x7fffeb, 23}, {0x7fffec, 23},
+    {0x1fffe0, 21}, {0x1fffe1, 21}, {0x3fffe0, 22}, {0x1fffe2, 21},
+    {0x7fffed, 23}, {0x3fffe1, 22}, {0x7fffee, 23}, {0x7fffef, 23},
+    {0xfffea, 20}, {0x3fffe2, 22}, {0x3fffe3, 22}, {0x3fffe4, 22},
+    {0x7ffff0, 23}, {0x3fffe5, 22}, {0x3fffe6, 22}, {0x7ffff1, 23},
+    {0x3ffffe0, 26}, {0x3ffffe1, 26}, {0xfffeb, 20}, {0x7fff1, 19},
+    {0x3fffe7, 22}, {0x7ffff2, 23}, {0x3fffe8, 22}, {0x1ffffec, 25},
+    {0x3ffffe2, 26}, {0x3ffffe3, 26}, {0x3ffffe4, 26}, {0x7ffffde, 27},
+    {0x7ffffdf, 27}, {0x3ffffe5, 26}, {0xfffff1, 24}, {0x1ffffed, 25},
+    {0x7fff2, 19}, {0x1fffe3, 21}, {0x3ffffe6, 26}, {0x7ffffe0, 27},
+    {0x7ffffe1, 27}, {0x3ffffe7, 26}, {0x7ffffe2, 27}, {0xfffff2, 24},
+    {0x1fffe4, 21}, {0x1fffe5, 21}, {0x3ffffe8, 26}, {0x3ffffe9, 26},
+    {0xffffffd, 28}, {0x7ffffe3, 27}, {0x7ffffe4, 27}, {0x7ffffe5, 27},
+    {0xfffec, 20}, {0xfffff3, 24}, {0xfffed, 20}, {0x1fffe6, 21},
+    {0x3fffe9, 22}, {0x1fffe7, 21}, {0x1fffe8, 21}, {0x7ffff3, 23},
+    {0x3fffea, 22}, {0x3fffeb, 22}, {0x1ffffee, 25}, {0x1ffffef, 25},
+    {0xfffff4, 24}, {0xfffff5, 24}, {0x3ffffea, 26}, {0x7ffff4, 23},
+    {0x3ffffeb, 26}, {0x7ffffe6, 27}, {0x3ffffec, 26}, {0x3ffffed, 26},
+    {0x7ffffe7, 27}, {0x7ffffe8, 27}, {0x7ffffe9, 27}, {0x7ffffea, 27},
+    {0x7ffffeb, 27}, {0xffffffe, 28}, {0x7ffffec, 27}, {0x7ffffed, 27},
+    {0x7ffffee, 27}, {0x7ffffef, 27}, {0x7fffff0, 27}, {0x3ffffee, 26},
+};
+
+// binary decoding tree built from `kHuffmanCodes` on first use
+struct HuffmanTree {
+    // children of each node (0 = none); leaves hold `symbol`
+    std::array<std::array<uint16_t, 2>, 512> next{};
+    std::array<int16_t, 512> symbol{};
+    uint16_t nodes = 1;
+
+    HuffmanTree() {
+        symbol.fill(-1);
+        for (int sym = 0; sym < 256; sym++) {
+            uint16_t node = 0;
+            for (int bit = kHuffmanCodes[sym].bits - 1; bit >= 0; bit--) {
+                int branch = (kHuffmanCodes[sym].code >> bit) & 1;
+                if (next[node][branch] == 0) next[node][branch] = nodes++;
+                node = next[node][branch];
+            }
+            symbol[node] = static_cast<int16_t>(sym);
+        }
+    }
+};
+
+/**
+ * @brief Decode an integer with an `prefix_bits`-bit prefix
+ * @return false if truncated or too large
+ */
+bool decode_integer(std::string_view in, size_t* pos, int prefix_bits,
+                    size_t* value) {
+    if (*pos >= in.size()) return false;
+    size_t max_prefix = (1U << prefix_bits) - 1;
+    *value = static_cast<uint8_t>(in[(*pos)++]) & max_prefix;
+    if (*value < max_prefix) return true;
+
+    for (int shift = 0; shift <= 28; shift += 7) {
+        if (*pos >= in.size()) return false;
+        auto byte = static_cast<uint8_t>(in[(*pos)++]);
+        *value += static_cast<size_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+bool decode_string(std::string_view in, size_t* pos, std::string* out) {
+    if (*pos >= in.size()) return false;
+    bool huffman = (static_cast<uint8_t>(in[*pos]) & 0x80) != 0;
+    size_t length;
+    if (!decode_integer(in, pos, 7, &length) || in.size() - *pos < length) {
+        return false;
+    }
+
+    std::string_view data = in.substr(*pos, length);
+    *pos += length;
+    out->clear();
+    if (huffman) return huffman_decode(data, out);
+    out->assign(data);
+    return true;
+}
+
+/**
+ * @brief Append an integer with an `prefix_bits`-bit prefix; `first` holds
+ * the representation's flag bits
+ */
+void encode_integer(size_t value, int prefix_bits, uint8_t first,
+                    std::string* out) {
+    size_t max_prefix = (1U << prefix_bits) - 1;
+    if (value < max_prefix) {
+        out->push_back(static_cast<char>(first | value));
+        return;
+    }
+    out->push_back(static_cast<char>(first | max_prefix));
+    value -= max_prefix;
+    while (value >= 0x80) {
+        out->push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out->push_back(static_cast<char>(value));
+}
+
+void encode_string(std::string_view value, std::string* out) {
+    encode_integer(value.size(), 7, 0, out);
+    out->append(value);
+}
+
+// headers whose values rarely repeat (or must not sit in a shared table)
+bool indexable(std::string_view name) {
+    return name != "content-length" && name != "date" && name != "set-cookie" &&
+           name != "etag" && name != "last-modified";
+}
+
+}  // namespace
+
+// ** HeaderTable **
+
+const Header* HeaderTable::at(size_t index) const {
+    if (index == 0) return nullptr;
+    if (index <= kStaticSize) return &kStaticTable[index - 1];
+    index -= kStaticSize + 1;
+    return index < entries_.size() ? &entries_[index] : nullptr;
+}
+
+void HeaderTable::insert(std::string name, std::string value) {
+    size_t entry_size = name.size() + value.size() + kEntryOverhead;
+    if (entry_size > max_size_) {
+        // an entry larger than the table empties it (RFC 7541 4.4)
+        evict(0);
+        return;
+    }
+
+    evict(max_size_ - entry_size);
+    size_ += entry_size;
+    entries_.emplace_front(std::move(name), std::move(value));
+}
+
+size_t HeaderTable::find(std::string_view name, std::string_view value,
+                         size_t* name_index) const {
+    *name_index = 0;
+    for (size_t i = 0; i < kStaticSize; i++) {
+        if (kStaticTable[i].first != name) continue;
+        if (kStaticTable[i].second == value) return i + 1;
+        if (*name_index == 0) *name_index = i + 1;
+    }
+    for (size_t i = 0; i < entries_.size(); i++) {
+        if (entries_[i].first != name) continue;
+        if (entries_[i].second == value) return kStaticSize + i + 1;
+        if (*name_index == 0) *name_index = kStaticSize + i + 1;
+    }
+    return 0;
+}
+
+void HeaderTable::set_max_size(size_t max_size) {
+    max_size_ = max_size;
+    evict(max_size_);
+}
+
+void HeaderTable::evict(size_t max_size) {
+    while (size_ > max_size) {
+        const Header& oldest = entries_.back();
+        size_ -= oldest.first.size() + oldest.second.size() + kEntryOverhead;
+        entries_.pop_back();
+    }
+}
+
+// ** Decoder **
+
+DecodeResult Decoder::decode(std::string_view block, HeaderList* headers,
+                             size_t max_list_size) {
+    constexpr DecodeResult kError = DecodeResult::kCompressionError;
+    size_t pos = 0;
+    bool first = true;
+    std::string name;
+    std::string value;
+    // checked per field, so a small block referencing a large table entry
+    // over and over can't expand into a huge list
+    size_t list_size = 0;
+    auto fits = [&list_size, max_list_size](const Header& field) {
+        list_size += field.first.size() + field.second.size() + kEntryOverhead;
+        return list_size <= max_list_size;
+    };
+
+    while (pos < block.size()) {
+        auto byte = static_cast<uint8_t>(block[pos]);
+        size_t index;
+
+        if (byte & 0x80) {
+            // indexed header field
+            if (!decode_integer(block, &pos, 7, &index)) return kError;
+            const Header* entry = table_.at(index);
+            if (entry == nullptr) return kError;
+            if (!fits(*entry)) return DecodeResult::kTooLarge;
+            headers->push_back(*entry);
+        } else if ((byte & 0xE0) == 0x20) {
+            // dynamic table size update: only at the start of a block, and
+            // never above our (default) SETTINGS_HEADER_TABLE_SIZE
+            size_t size;
+            if (!first || !decode_integer(block, &pos, 5, &size) ||
+                size > kDefaultTableSize) {
+                return kError;
+            }
+            table_.set_max_size(size);
+            continue;
+        } else {
+            // literal: with incremental indexing (01), without indexing
+            // (0000) or never indexed (0001)
+            bool incremental = (byte & 0xC0) == 0x40;
+            if (!decode_integer(block, &pos, incremental ? 6 : 4, &index)) {
+                return kError;
+            }
+
+            if (index == 0) {
+                if (!decode_string(block, &pos, &name)) return kError;
+            } else {
+                const Header* entry = table_.at(index);
+                if (entry == nullptr) return kError;
+                name = entry->first;
+            }
+            if (!decode_string(block, &pos, &value)) return kError;
+
+            headers->emplace_back(name, value);
+            if (!fits(headers->back())) return DecodeResult::kTooLarge;
+            if (incremental) table_.insert(name, value);
+        }
+        first = false;
+    }
+
+    return DecodeResult::kOk;
+}
+
+// ** Encoder **
+
+void Encoder::encode(const HeaderList& headers, std::string* out) {
+    if (size_update_pending_) {
+        encode_integer(table_.max_size(), 5, 0x20, out);
+        size_update_pending_ = false;
+    }
+
+    for (const auto& [name, value] : headers) {
+        size_t name_index;
+        size_t index = table_.find(name, value, &name_index);
+        if (index != 0) {
+            encode_integer(index, 7, 0x80, out);
+            continue;
+        }
+
+        bool indexed = indexable(name);
+        if (indexed) {
+            encode_integer(name_index, 6, 0x40, out);
+        } else {
+            encode_integer(name_index, 4, 0x00, out);
+        }
+        if (name_index == 0) encode_string(name, out);
+        encode_string(value, out);
+
+        if (indexed) table_.insert(name, value);
+    }
+}
+
+void Encoder::set_max_table_size(size_t size) {
+    size = std::min(size, kDefaultTableSize);
+    if (size == table_.max_size()) return;
+    table_.set_max_size(size);
+    size_update_pending_ = true;
+}
+
+// ** Huffman **
+
+bool huffman_decode(std::string_view in, std::string* out) {
+    static const HuffmanTree kTree;
+
+    uint16_t node = 0;
+    // bits consumed since the last symbol, and whether they were all ones
+    int depth = 0;
+    bool all_ones = true;
+
+    for (char c : in) {
+        auto byte = static_cast<uint8_t>(c);
+        for (int bit = 7; bit >= 0; bit--) {
+            int branch = (byte >> bit) & 1;
+            node = kTree.next[node][branch];
+            if (node == 0) return false;  // EOS or invalid code
+            depth++;
+            all_ones = all_ones && branch == 1;
+
+            if (kTree.symbol[node] >= 0) {
+                out->push_back(static_cast<char>(kTree.symbol[node]));
+                node = 0;
+                depth = 0;
+                all_ones = true;
+            }
+        }
+    }
+
+    // padding must be a (< 8 bit) prefix of EOS, i.e. all ones
+    return depth < 8 && all_ones;
+}
+
+}  // namespace brick::http2
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * HPACK header compression (RFC 7541): static and dynamic tables, integer and
+ * string primitives, and Huffman decoding.
+ *
+ * Decoding accepts everything a peer may send. Encoding indexes repeated
+ * response headers in the dynamic table (so a response on a warm connection
+ * is mostly one-byte table references) and sends literals without Huffman
+ * coding.
+ */
+
+namespace brick::http2 {
+
+using Header = std::pair<std::string, std::string>;
+using HeaderList = std::vector<Header>;
+
+// SETTINGS_HEADER_TABLE_SIZE default
+constexpr size_t kDefaultTableSize = 4096;
+
+/**
+ * @brief The combined static + dynamic table, addressed by HPACK index
+ * (1-61 static, 62+ dynamic, newest first)
+ */
+class HeaderTable {
+   public:
+    explicit HeaderTable(size_t max_size = kDefaultTableSize)
+        : max_size_(max_size) {}
+
+    /**
+     * @brief Look up an entry
+     * @param `index` HPACK index
+     * @return the entry, or nullptr if `index` is out of range
+     */
+    const Header* at(size_t index) const;
+
+    /**
+     * @brief Add an entry to the dynamic table, evicting old ones to fit
+     */
+    void insert(std::string name, std::string value);
+
+    /**
+     * @brief Find an entry
+     * @param `name_index` set to the index of an entry with the same name, or
+     * 0 if there is none
+     * @return index of an entry matching name and value, or 0
+     */
+    size_t find(std::string_view name, std::string_view value,
+                size_t* name_index) const;
+
+    void set_max_size(size_t max_size);
+    size_t max_size() const { return max_size_; }
+
+   private:
+    void evict(size_t max_size);
+
+    std::deque<Header> entries_;
+    size_t size_ = 0;
+    size_t max_size_;
+};
+
+enum class DecodeResult {
+    kOk,
+    // malformed block
+    kCompressionError,
+    // the decoded list outgrew the limit; decoding stopped there
+    kTooLarge,
+};
+
+class Decoder {
+   public:
+    /**
+     * @brief Decode a complete header block. Either error leaves the dynamic
+     * table out of step with the peer's, so it is fatal for the connection.
+     * @param `block` the concatenated HEADERS + CONTINUATION fragments
+     * @param `headers` decoded headers are appended here
+     * @param `max_list_size` limit on the decoded size: names plus values
+     * plus 32 bytes per field, as for SETTINGS_MAX_HEADER_LIST_SIZE
+     */
+    DecodeResult decode(std::string_view block, HeaderList* headers,
+                        size_t max_list_size = SIZE_MAX);
+
+   private:
+    HeaderTable table_;
+};
+
+class Encoder {
+   public:
+    /**
+     * @brief Encode a header block
+     * @param `headers` the headers, names already lowercase
+     * @param `out` the block is appended here
+     */
+    void encode(const HeaderList& headers, std::string* out);
+
+    /**
+     * @brief Apply the peer's SETTINGS_HEADER_TABLE_SIZE
+     */
+    void set_max_table_size(size_t size);
+
+   private:
+    HeaderTable table_;
+    bool size_update_pending_ = false;
+};
+
+/**
+ * @brief Decode a Huffman-coded string literal
+ * @return false if `in` is not validly coded or padded
+ */
+bool huffman_decode(std::string_view in, std::string* out);
+
+}  // namespace brick::http2
@@ -0,0 +1,205 @@
+#include "brick/http2/hpack.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+
+namespace brick::http2 {
+namespace {
+
+// "82 86 84" -> the bytes; spaces are ignored
+std::string unhex(std::string_view hex) {
+    std::string out;
+    int nibbles = 0;
+    int byte = 0;
+    for (char c : hex) {
+        if (c == ' ') continue;
+        byte = byte * 16 + (c <= '9' ? c - '0' : c - 'a' + 10);
+        if (++nibbles % 2 == 0) {
+            out.push_back(static_cast<char>(byte));
+            byte = 0;
+        }
+    }
+    return out;
+}
+
+HeaderList decode(Decoder* decoder, std::string_view hex) {
+    HeaderList headers;
+    EXPECT_EQ(decoder->decode(unhex(hex), &headers), DecodeResult::kOk);
+    return headers;
+}
+
+// RFC 7541 appendix C.2: the field representations, one per block
+TEST(HpackDecodeTest, FieldRepresentations) {
+    Decoder decoder;
+    EXPECT_EQ(decode(&decoder,
+                     "400a 6375 7374 6f6d 2d6b 6579 0d63 7573 746f 6d2d 6865 "
+                     "6164 6572"),
+              (HeaderList{{"custom-key", "custom-header"}}));
+    // (the entry added above is index 62)
+    EXPECT_EQ(decode(&decoder, "be"),
+              (HeaderList{{"custom-key", "custom-header"}}));
+
+    EXPECT_EQ(decode(&decoder, "040c 2f73 616d 706c 652f 7061 7468"),
+              (HeaderList{{":path", "/sample/path"}}));
+    EXPECT_EQ(decode(&decoder,
+                     "1008 7061 7373 776f 7264 0673 6563 7265 74"),
+              (HeaderList{{"password", "secret"}}));
+    EXPECT_EQ(decode(&decoder, "82"), (HeaderList{{":method", "GET"}}));
+}
+
+const HeaderList kRequest1 = {{":method", "GET"},
+                              {":scheme", "http"},
+                              {":path", "/"},
+                              {":authority", "www.example.com"}};
+const HeaderList kRequest2 = {{":method", "GET"},
+                              {":scheme", "http"},
+                              {":path", "/"},
+                              {":authority", "www.example.com"},
+                              {"cache-control", "no-cache"}};
+const HeaderList kRequest3 = {{":method", "GET"},
+                              {":scheme", "https"},
+                              {":path", "/index.html"},
+                              {":authority", "www.example.com"},
+                              {"custom-key", "custom-value"}};
+
+// C.3: requests on one connection, later ones referencing the dynamic table
+TEST(HpackDecodeTest, Requests) {
+    Decoder decoder;
+    EXPECT_EQ(decode(&decoder,
+                     "8286 8441 0f77 7777 2e65 7861 6d70 6c65 2e63 6f6d"),
+              kRequest1);
+    EXPECT_EQ(decode(&decoder, "8286 84be 5808 6e6f 2d63 6163 6865"),
+              kRequest2);
+    EXPECT_EQ(decode(&decoder,
+                     "8287 85bf 400a 6375 7374 6f6d 2d6b 6579 0c63 7573 746f "
+                     "6d2d 7661 6c75 65"),
+              kRequest3);
+}
+
+// C.4: the same requests, Huffman coded
+TEST(HpackDecodeTest, HuffmanRequests) {
+    Decoder decoder;
+    EXPECT_EQ(decode(&decoder, "8286 8441 8cf1 e3c2 e5f2 3a6b a0ab 90f4 ff"),
+              kRequest1);
+    EXPECT_EQ(decode(&decoder, "8286 84be 5886 a8eb 1064 9cbf"), kRequest2);
+    EXPECT_EQ(decode(&decoder,
+                     "8287 85bf 4088 25a8 49e9 5ba9 7d7f 8925 a849 e95b b8e8 "
+                     "b4bf"),
+              kRequest3);
+}
+
+const HeaderList kResponse1 = {
+    {":status", "302"},
+    {"cache-control", "private"},
+    {"date", "Mon, 21 Oct 2013 20:13:21 GMT"},
+    {"location", "https://www.example.com"}};
+const HeaderList kResponse2 = {
+    {":status", "307"},
+    {"cache-control", "private"},
+    {"date", "Mon, 21 Oct 2013 20:13:21 GMT"},
+    {"location", "https://www.example.com"}};
+const HeaderList kResponse3 = {
+    {":status", "200"},
+    {"cache-control", "private"},
+    {"date", "Mon, 21 Oct 2013 20:13:22 GMT"},
+    {"location", "https://www.example.com"},
+    {"content-encoding", "gzip"},
+    {"set-cookie", "foo=ASDJKHQKBZXOQWEOPIUAXQWEOIU; max-age=3600; version=1"}};
+
+// the C.5 and C.6 examples assume a 256-byte table, so entries get evicted;
+// the first block starts with a size update to get there
+constexpr std::string_view kTableSize256 = "3fe1 01 ";
+
+// C.5: responses on one connection, with evictions
+TEST(HpackDecodeTest, Responses) {
+    Decoder decoder;
+    EXPECT_EQ(decode(&decoder,
+                     std::string(kTableSize256) +
+                         "4803 3330 3258 0770 7269 7661 7465 611d 4d6f 6e2c "
+                         "2032 3120 4f63 7420 3230 3133 2032 303a 3133 3a32 "
+                         "3120 474d 546e 1768 7474 7073 3a2f 2f77 7777 2e65 "
+                         "7861 6d70 6c65 2e63 6f6d"),
+              kResponse1);
+    EXPECT_EQ(decode(&decoder, "4803 3330 37c1 c0bf"), kResponse2);
+    EXPECT_EQ(decode(&decoder,
+                     "88c1 611d 4d6f 6e2c 2032 3120 4f63 7420 3230 3133 2032 "
+                     "303a 3133 3a32 3220 474d 54c0 5a04 677a 6970 7738 666f "
+                     "6f3d 4153 444a 4b48 514b 425a 584f 5157 454f 5049 5541 "
+                     "5851 5745 4f49 553b 206d 6178 2d61 6765 3d33 3630 303b "
+                     "2076 6572 7369 6f6e 3d31"),
+              kResponse3);
+}
+
+// C.6: the same responses, Huffman coded
+TEST(HpackDecodeTest, HuffmanResponses) {
+    Decoder decoder;
+    EXPECT_EQ(decode(&decoder,
+                     std::string(kTableSize256) +
+                         "4882 6402 5885 aec3 771a 4b61 96d0 7abe 9410 54d4 "
+                         "44a8 2005 9504 0b81 66e0 82a6 2d1b ff6e 919d 29ad "
+                         "1718 63c7 8f0b 97c8 e9ae 82ae 43d3"),
+              kResponse1);
+    EXPECT_EQ(decode(&decoder, "4883 640e ffc1 c0bf"), kResponse2);
+    EXPECT_EQ(decode(&decoder,
+                     "88c1 6196 d07a be94 1054 d444 a820 0595 040b 8166 e084 "
+                     "a62d 1bff c05a 839b d9ab 77ad 94e7 821d d7f2 e6c7 b335 "
+                     "dfdf cd5b 3960 d5af 2708 7f36 72c1 ab27 0fb5 291f 9587 "
+                     "3160 65c0 03ed 4ee5 b106 3d50 07"),
+              kResponse3);
+}
+
+DecodeResult decode_error(std::string_view hex) {
+    Decoder decoder;
+    HeaderList headers;
+    return decoder.decode(unhex(hex), &headers);
+}
+
+TEST(HpackDecodeTest, RejectsMalformedBlocks) {
+    // index 0, and past the end of the (empty) dynamic table
+    EXPECT_EQ(decode_error("80"), DecodeResult::kCompressionError);
+    EXPECT_EQ(decode_error("be"), DecodeResult::kCompressionError);
+    // integer cut short, and one that overflows
+    EXPECT_EQ(decode_error("ff"), DecodeResult::kCompressionError);
+    EXPECT_EQ(decode_error("ff ffff ffff ffff ffff ffff 7f"),
+              DecodeResult::kCompressionError);
+    // string longer than the block
+    EXPECT_EQ(decode_error("4005 6162"), DecodeResult::kCompressionError);
+    // Huffman padding that isn't all ones, and padding of 8+ bits
+    EXPECT_EQ(decode_error("4081 00 00"), DecodeResult::kCompressionError);
+    EXPECT_EQ(decode_error("4082 1fff 00"), DecodeResult::kCompressionError);
+    // table size update after a field, and above our setting
+    EXPECT_EQ(decode_error("82 20"), DecodeResult::kCompressionError);
+    EXPECT_EQ(decode_error("3fe2 1f"), DecodeResult::kCompressionError);
+}
+
+TEST(HpackDecodeTest, StopsAtListLimit) {
+    Decoder decoder;
+    HeaderList headers;
+    // ":method: GET" is 7 + 3 + 32 = 42 bytes
+    EXPECT_EQ(decoder.decode(unhex("8282"), &headers, 84), DecodeResult::kOk);
+    headers.clear();
+    EXPECT_EQ(decoder.decode(unhex("828282"), &headers, 84),
+              DecodeResult::kTooLarge);
+    EXPECT_EQ(headers.size(), 2);
+}
+
+TEST(HpackEncodeTest, RoundTrips) {
+    Encoder encoder;
+    Decoder decoder;
+    HeaderList response = {{":status", "200"},
+                           {"content-type", "text/plain"},
+                           {"x-custom", "value"}};
+    // the second block reuses the table entries added by the first
+    for (int i = 0; i < 2; i++) {
+        std::string block;
+        encoder.encode(response, &block);
+        HeaderList headers;
+        EXPECT_EQ(decoder.decode(block, &headers), DecodeResult::kOk);
+        EXPECT_EQ(headers, response);
+    }
+}
+
+}  // namespace
+}  // namespace brick::http2
@@ -0,0 +1,713 @@
+#include "session.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <utility>
+
+namespace brick::http2 {
+
+namespace {
+
+// HTTP/1-style capitalization ("content-type" -> "Content-Type"), so handlers
+// see the same header names whichever protocol the client used
+std::string canonical_name(std::string_view name) {
+    std::string canonical(name);
+    bool upper = true;
+    for (char& c : canonical) {
+        c = static_cast<char>(upper ? std::toupper(static_cast<uint8_t>(c))
+                                    : std::tolower(static_cast<uint8_t>(c)));
+        upper = c == '-';
+    }
+    return canonical;
+}
+
+std::string lowercase(std::string_view name) {
+    std::string lower(name);
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+                   [](uint8_t c) { return std::tolower(c); });
+    return lower;
+}
+
+// connection-specific headers are not allowed in HTTP/2 (RFC 9113 8.2.2)
+bool connection_specific(std::string_view name) {
+    return name == "connection" || name == "keep-alive" ||
+           name == "proxy-connection" || name == "transfer-encoding" ||
+           name == "upgrade";
+}
+
+int base64url_value(char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '-' || c == '+') return 62;
+    if (c == '_' || c == '/') return 63;
+    return -1;
+}
+
+}  // namespace
+
+Session::Session(Dispatch dispatch) : dispatch_(std::move(dispatch)) {
+    // server connection preface: our SETTINGS, then open up the connection
+    // window to match the per-stream one
+    std::string settings;
+    auto add_setting = [&settings](Setting id, uint32_t value) {
+        settings.push_back(static_cast<char>(static_cast<uint16_t>(id) >> 8));
+        settings.push_back(static_cast<char>(static_cast<uint16_t>(id)));
+        write_u32(value, &settings);
+    };
+    add_setting(Setting::kMaxConcurrentStreams, kMaxConcurrentStreams);
+    add_setting(Setting::kInitialWindowSize, kInitialWindow);
+    add_setting(Setting::kEnablePush, 0);
+    add_setting(Setting::kMaxHeaderListSize, kMaxHeaderList);
+    write_frame(FrameType::kSettings, 0, 0, settings, &out_);
+    write_window_update(0, kInitialWindow - kDefaultWindow);
+}
+
+bool Session::upgrade(Request request, std::string_view settings) {
+    // the HTTP2-Settings values apply as if sent in a SETTINGS frame, and are
+    // acknowledged implicitly by the 101
+    if (!apply_settings(settings)) return false;
+
+    last_stream_id_ = 1;
+    Stream& stream = streams_[1];
+    stream.send_window = initial_send_window_;
+    stream.vtime = vtime_;
+    stream.request_done = true;
+
+    respond(1, stream, dispatch_(request));
+    schedule();
+    return true;
+}
+
+size_t Session::receive(std::string_view in) {
+    size_t pos = 0;
+
+    if (!preface_received_) {
+        bool partial;
+        if (!is_preface(in, &partial)) {
+            if (!partial) connection_error(ErrorCode::kProtocolError);
+            return partial ? 0 : in.size();
+        }
+        preface_received_ = true;
+        pos = kClientPreface.size();
+    }
+
+    FrameHeader header;
+    while (!failed_ && parse_frame_header(in.substr(pos), &header)) {
+        if (header.length > kDefaultMaxFrameSize) {
+            connection_error(ErrorCode::kFrameSizeError);
+            break;
+        }
+        if (in.size() - pos - kFrameHeaderSize < header.length) break;
+
+        std::string_view payload =
+            in.substr(pos + kFrameHeaderSize, header.length);
+        pos += kFrameHeaderSize + header.length;
+
+        if (!handle_frame(header, payload)) break;
+    }
+
+    schedule();
+
+    // after a connection error nothing else is read
+    return failed_ ? in.size() : pos;
+}
+
+std::string Session::take_output() { return std::exchange(out_, {}); }
+
+void Session::go_away() {
+    if (goaway_sent_) return;
+    write_goaway(ErrorCode::kNoError);
+}
+
+bool Session::closed() const {
+    return failed_ || ((goaway_sent_ || peer_goaway_) && streams_.empty());
+}
+
+bool Session::is_preface(std::string_view in, bool* partial) {
+    size_t n = std::min(in.size(), kClientPreface.size());
+    bool matches = in.substr(0, n) == kClientPreface.substr(0, n);
+    *partial = matches && n < kClientPreface.size();
+    return matches && n == kClientPreface.size();
+}
+
+bool Session::decode_settings_header(std::string_view value,
+                                     std::string* out) {
+    uint32_t bits = 0;
+    int count = 0;
+    for (char c : value) {
+        if (c == '=') break;
+        int v = base64url_value(c);
+        if (v < 0) return false;
+        bits = (bits << 6) | v;
+        count += 6;
+        if (count >= 8) {
+            count -= 8;
+            out->push_back(static_cast<char>(bits >> count));
+        }
+    }
+    return out->size() % 6 == 0;
+}
+
+// ** frame handlers **
+
+bool Session::handle_frame(const FrameHeader& header,
+                           std::string_view payload) {
+    // a header block must not be interleaved with any other frame
+    if (header_stream_id_ != 0 && header.type != FrameType::kContinuation) {
+        return connection_error(ErrorCode::kProtocolError);
+    }
+
+    switch (header.type) {
+        case FrameType::kData:
+            return handle_data(header, payload);
+        case FrameType::kHeaders:
+            return handle_headers(header, payload);
+        case FrameType::kPriority:
+            return handle_priority(header, payload);
+        case FrameType::kRstStream:
+            return handle_rst_stream(header, payload);
+        case FrameType::kSettings:
+            return handle_settings(header, payload);
+        case FrameType::kPushPromise:
+            // clients can't push
+            return connection_error(ErrorCode::kProtocolError);
+        case FrameType::kPing:
+            return handle_ping(header, payload);
+        case FrameType::kGoAway:
+            return handle_goaway(header, payload);
+        case FrameType::kWindowUpdate:
+            return handle_window_update(header, payload);
+        case FrameType::kContinuation:
+            return handle_continuation(header, payload);
+    }
+
+    // unknown frame types are ignored
+    return true;
+}
+
+bool Session::handle_data(const FrameHeader& header,
+                          std::string_view payload) {
+    if (header.stream_id == 0) {
+        return connection_error(ErrorCode::kProtocolError);
+    }
+
+    // flow control counts the whole payload, padding included
+    connection_unacked_receive_ += header.length;
+    if (connection_unacked_receive_ >= kInitialWindow / 2) {
+        write_window_update(0, connection_unacked_receive_);
+        connection_unacked_receive_ = 0;
+    }
+
+    if (!strip_padding(header, &payload)) {
+        return connection_error(ErrorCode::kProtocolError);
+    }
+
+    auto it = streams_.find(header.stream_id);
+    if (it == streams_.end() || it->second.request_done) {
+        if (header.stream_id > last_stream_id_) {
+            return connection_error(ErrorCode::kProtocolError);  // idle
+        }
+        reset_stream(header.stream_id, ErrorCode::kStreamClosed);
+        return true;
+    }
+
+    Stream& stream = it->second;
+    if (stream.body.size() + payload.size() > kMaxBodySize) {
+        reset_stream(header.stream_id, ErrorCode::kEnhanceYourCalm);
+        return true;
+    }
+    stream.body.append(payload);
+
+    if (header.flags & flags::kEndStream) {
+        stream.request_done = true;
+        dispatch(header.stream_id, stream);
+        return true;
+    }
+
+    stream.unacked_receive += header.length;
+    if (stream.unacked_receive >= kInitialWindow / 2) {
+        write_window_update(header.stream_id, stream.unacked_receive);
+        stream.unacked_receive = 0;
+    }
+    return true;
+}
+
+bool Session::handle_headers(const FrameHeader& header,
+                             std::string_view payload) {
+    // client streams are odd-numbered
+    if (header.stream_id == 0 || header.stream_id % 2 == 0) {
+        return connection_error(ErrorCode::kProtocolError);
+    }
+    if (!strip_padding(header, &payload)) {
+        return connection_error(ErrorCode::kProtocolError);
+    }
+
+    header_priority_.clear();
+    if (header.flags & flags::kPriority) {
+        if (payload.size() < 5) {
+            return connection_error(ErrorCode::kFrameSizeError);
+        }
+        header_priority_ = payload.substr(0, 5);
+        payload.remove_prefix(5);
+    }
+
+    header_block_.assign(payload);
+    header_stream_id_ = header.stream_id;
+    header_end_stream_ = (header.flags & flags::kEndStream) != 0;
+
+    if (header.flags & flags::kEndHeaders) return finish_headers();
+    return true;
+}
+
+bool Session::handle_continuation(const FrameHeader& header,
+                                  std::string_view payload) {
+    if (header_stream_id_ == 0 || header.stream_id != header_stream_id_) {
+        return connection_error(ErrorCode::kProtocolError);
+    }
+    if (header_block_.size() + payload.size() > kMaxHeaderBlock) {
+        return connection_error(ErrorCode::kEnhanceYourCalm);
+    }
+
+    header_block_.append(payload);
+    if (header.flags & flags::kEndHeaders) return finish_headers();
+    return true;
+}
+
+bool Session::finish_headers() {
+    uint32_t stream_id = std::exchange(header_stream_id_, 0);
+
+    // always decode, even for refused streams: the HPACK state is shared.
+    // Stopping part-way leaves it out of step, so an oversized list ends the
+    // connection rather than just the stream.
+    HeaderList headers;
+    switch (decoder_.decode(header_block_, &headers, kMaxHeaderList)) {
+        case DecodeResult::kOk:
+            break;
+        case DecodeResult::kCompressionError:
+            return connection_error(ErrorCode::kCompressionError);
+        case DecodeResult::kTooLarge:
+            return connection_error(ErrorCode::kEnhanceYourCalm);
+    }
+
+    auto it = streams_.find(stream_id);
+    if (it != streams_.end()) {
+        // trailers: must end the stream, and are otherwise ignored
+        if (it->second.request_done || !header_end_stream_) {
+            return connection_error(ErrorCode::kProtocolError);
+        }
+        it->second.request_done = true;
+        dispatch(stream_id, it->second);
+        return true;
+    }
+
+    if (stream_id <= last_stream_id_) {
+        return connection_error(ErrorCode::kStreamClosed);
+    }
+    last_stream_id_ = stream_id;
+
+    if (goaway_sent_) return true;
+    if (streams_.size() >= kMaxConcurrentStreams) {
+        reset_stream(stream_id, ErrorCode::kRefusedStream);
+        return true;
+    }
+
+    Stream& stream = streams_[stream_id];
+    stream.headers = std::move(headers);
+    stream.send_window = initial_send_window_;
+    stream.vtime = vtime_;
+    // a stream can't depend on itself: it has been reset (and erased)
+    if (!header_priority_.empty() &&
+        !set_priority(stream_id, stream, header_priority_)) {
+        return true;
+    }
+
+    if (header_end_stream_) {
+        stream.request_done = true;
+        dispatch(stream_id, stream);
+    }
+    return true;
+}
+
+bool Session::handle_priority(const FrameHeader& header,
+                              std::string_view payload) {
+    if (header.stream_id == 0) {
+        return connection_error(ErrorCode::kProtocolError);
+    }
+    if (payload.size() != 5) {
+        reset_stream(header.stream_id, ErrorCode::kFrameSizeError);
+        return true;
+    }
+
+    // priority for streams we don't know (idle or closed) is ignored
+    auto it = streams_.find(header.stream_id);
+    if (it != streams_.end()) {
+        set_priority(header.stream_id, it->second, payload);
+    }
+    return true;
+}
+
+bool Session::handle_rst_stream(const FrameHeader& header,
+                                std::string_view payload) {
+    if (header.stream_id == 0 || header.stream_id > last_stream_id_) {
+        return connection_error(ErrorCode::kProtocolError);
+    }
+    if (payload.size() != 4) {
+        return connection_error(ErrorCode::kFrameSizeError);
+    }
+
+    streams_.erase(header.stream_id);
+    return true;
+}
+
+bool Session::handle_settings(const FrameHeader& header,
+                              std::string_view payload) {
+    if (header.stream_id != 0) {
+        return connection_error(ErrorCode::kProtocolError);
+    }
+    if (header.flags & flags::kAck) {
+        return payload.empty() ||
+               connection_error(ErrorCode::kFrameSizeError);
+    }
+    if (payload.size() % 6 != 0) {
+        return connection_error(ErrorCode::kFrameSizeError);
+    }
+
+    if (!apply_settings(payload)) return false;
+    write_frame(FrameType::kSettings, flags::kAck, 0, {}, &out_);
+    return true;
+}
+
+bool Session::apply_settings(std::string_view payload) {
+    if (payload.size() % 6 != 0) return false;
+
+    for (size_t i = 0; i < payload.size(); i += 6) {
+        auto id = static_cast<Setting>(
+            (static_cast<uint8_t>(payload[i]) << 8) |
+            static_cast<uint8_t>(payload[i + 1]));
+        uint32_t value = read_u32(payload.substr(i + 2));
+
+        switch (id) {
+            case Setting::kHeaderTableSize:
+                encoder_.set_max_table_size(value);
+                break;
+
+            case Setting::kInitialWindowSize: {
+                if (value > kMaxWindow) {
+                    return connection_error(ErrorCode::kFlowControlError);
+                }
+                // applies retroactively to every open stream
+                int64_t delta = static_cast<int64_t>(value) -
+                                initial_send_window_;
+                initial_send_window_ = value;
+                for (auto& [id, stream] : streams_) {
+                    stream.send_window += delta;
+                    if (stream.send_window > kMaxWindow) {
+                        return connection_error(ErrorCode::kFlowControlError);
+                    }
+                }
+                break;
+            }
+
+            case Setting::kMaxFrameSize:
+                if (value < kDefaultMaxFrameSize || value > 0xFFFFFF) {
+                    return connection_error(ErrorCode::kProtocolError);
+                }
+                max_send_frame_ = value;
+                break;
+
+            case Setting::kEnablePush:
+                if (value > 1) {
+                    return connection_error(ErrorCode::kProtocolError);
+                }
+                break;
+
+            default:
+                // MAX_CONCURRENT_STREAMS (we never push), MAX_HEADER_LIST_SIZE
+                // and unknown settings need no action
+                break;
+        }
+    }
+    return true;
+}
+
+bool Session::handle_ping(const FrameHeader& header,
+                          std::string_view payload) {
+    if (header.stream_id != 0) {
+        return connection_error(ErrorCode::kProtocolError);
+    }
+    if (payload.size() != 8) {
+        return connection_error(ErrorCode::kFrameSizeError);
+    }
+
+    if (!(header.flags & flags::kAck)) {
+        write_frame(FrameType::kPing, flags::kAck, 0, payload, &out_);
+    }
+    return true;
+}
+
+bool Session::handle_goaway(const FrameHeader& header,
+                            std::string_view payload) {
+    if (header.stream_id != 0) {
+        return connection_error(ErrorCode::kProtocolError);
+    }
+    if (payload.size() < 8) {
+        return connection_error(ErrorCode::kFrameSizeError);
+    }
+
+    peer_goaway_ = true;
+    return true;
+}
+
+bool Session::handle_window_update(const FrameHeader& header,
+                                   std::string_view payload) {
+    if (payload.size() != 4) {
+        return connection_error(ErrorCode::kFrameSizeError);
+    }
+    uint32_t increment = read_u31(payload);
+
+    if (header.stream_id == 0) {
+        if (increment == 0) {
+            return connection_error(ErrorCode::kProtocolError);
+        }
+        connection_send_window_ += increment;
+        if (connection_send_window_ > kMaxWindow) {
+            return connection_error(ErrorCode::kFlowControlError);
+        }
+        return true;
+    }
+
+    auto it = streams_.find(header.stream_id);
+    if (it == streams_.end()) {
+        // closed streams may still see in-flight updates
+        return header.stream_id <= last_stream_id_ ||
+               connection_error(ErrorCode::kProtocolError);
+    }
+
+    if (increment == 0) {
+        reset_stream(header.stream_id, ErrorCode::kProtocolError);
+        return true;
+    }
+    it->second.send_window += increment;
+    if (it->second.send_window > kMaxWindow) {
+        reset_stream(header.stream_id, ErrorCode::kFlowControlError);
+    }
+    return true;
+}
+
+bool Session::strip_padding(const FrameHeader& header,
+                            std::string_view* payload) {
+    if (!(header.flags & flags::kPadded)) return true;
+    if (payload->empty()) return false;
+
+    auto padding = static_cast<uint8_t>((*payload)[0]);
+    if (padding >= payload->size()) return false;
+
+    *payload = payload->substr(1, payload->size() - 1 - padding);
+    return true;
+}
+
+bool Session::set_priority(uint32_t stream_id, Stream& stream,
+                           std::string_view priority) {
+    uint32_t parent = read_u31(priority);
+    bool exclusive = (static_cast<uint8_t>(priority[0]) & 0x80) != 0;
+    if (parent == stream_id) {
+        reset_stream(stream_id, ErrorCode::kProtocolError);
+        return false;
+    }
+
+    // moving under one of its own descendants: that descendant first takes
+    // the stream's old place, so the tree never gets a cycle (RFC 7540
+    // 5.3.3)
+    if (depends_on(parent, stream_id)) {
+        streams_.find(parent)->second.parent = stream.parent;
+    }
+    // an exclusive dependency adopts the new parent's other children
+    if (exclusive) {
+        for (auto& [id, other] : streams_) {
+            if (other.parent == parent && id != stream_id) {
+                other.parent = stream_id;
+            }
+        }
+    }
+
+    stream.parent = parent;
+    stream.weight = static_cast<uint8_t>(priority[4]) + 1;
+    return true;
+}
+
+bool Session::depends_on(uint32_t stream_id, uint32_t ancestor) const {
+    // (ids of streams that are gone end the chain: they count as the root)
+    for (size_t depth = 0; stream_id != 0 && depth <= streams_.size();
+         depth++) {
+        auto it = streams_.find(stream_id);
+        if (it == streams_.end()) return false;
+        stream_id = it->second.parent;
+        if (stream_id == ancestor) return true;
+    }
+    return false;
+}
+
+// ** requests and responses **
+
+void Session::dispatch(uint32_t stream_id, Stream& stream) {
+    std::string method;
+    std::string path;
+    std::map<std::string, std::string> headers;
+
+    for (auto& [name, value] : stream.headers) {
+        if (name == ":method") {
+            method = std::move(value);
+        } else if (name == ":path") {
+            path = std::move(value);
+        } else if (name == ":authority") {
+            headers["Host"] = std::move(value);
+        } else if (!name.empty() && name[0] != ':') {
+            std::string key = canonical_name(name);
+            auto [it, inserted] = headers.try_emplace(key, std::move(value));
+            // repeated fields combine into a list (cookies use "; ")
+            if (!inserted) {
+                it->second += (key == "Cookie" ? "; " : ", ") + value;
+            }
+        }
+    }
+    stream.headers.clear();
+
+    if (method.empty() || path.empty()) {
+        reset_stream(stream_id, ErrorCode::kProtocolError);
+        return;
+    }
+
+    Request request(std::move(method), std::move(path), "HTTP/2",
+                    std::move(headers), std::move(stream.body));
+    respond(stream_id, stream, dispatch_(request));
+}
+
+void Session::respond(uint32_t stream_id, Stream& stream, Response response) {
+    HeaderList headers;
+    headers.emplace_back(":status", std::to_string(response.status_code()));
+    auto add = [&headers](const std::string& name, const std::string& value) {
+        std::string lower = lowercase(name);
+        if (!connection_specific(lower)) {
+            headers.emplace_back(std::move(lower), value);
+        }
+    };
+    for (const auto& [name, value] : response.headers()) add(name, value);
+    for (const auto& [name, value] : response.extra_headers()) {
+        add(name, value);
+    }
+
+    std::string block;
+    encoder_.encode(headers, &block);
+
+    stream.response = response.release_body();
+    stream.responded = true;
+    bool end_stream = stream.response.empty();
+
+    // HEADERS, then CONTINUATIONs for whatever doesn't fit in one frame
+    std::string_view rest(block);
+    FrameType type = FrameType::kHeaders;
+    do {
+        std::string_view fragment = rest.substr(0, max_send_frame_);
+        rest.remove_prefix(fragment.size());
+
+        uint8_t frame_flags = rest.empty() ? flags::kEndHeaders : 0;
+        if (type == FrameType::kHeaders && end_stream) {
+            frame_flags |= flags::kEndStream;
+        }
+        write_frame(type, frame_flags, stream_id, fragment, &out_);
+        type = FrameType::kContinuation;
+    } while (!rest.empty());
+
+    if (end_stream) streams_.erase(stream_id);
+}
+
+bool Session::blocked_by_parent(const Stream& stream) const {
+    // a stream waits while an ancestor still has data to send
+    uint32_t parent = stream.parent;
+    for (int depth = 0; parent != 0 && depth < 8; depth++) {
+        auto it = streams_.find(parent);
+        if (it == streams_.end()) return false;
+        const Stream& ancestor = it->second;
+        if (ancestor.responded &&
+            ancestor.response_offset < ancestor.response.size() &&
+            ancestor.send_window > 0) {
+            return true;
+        }
+        parent = ancestor.parent;
+    }
+    return false;
+}
+
+void Session::schedule() {
+    // weighted fair queuing: repeatedly send one frame from the sendable
+    // stream with the smallest virtual finish time
+    while (connection_send_window_ > 0) {
+        uint32_t next_id = 0;
+        Stream* next = nullptr;
+        for (auto& [id, stream] : streams_) {
+            if (!stream.responded || stream.send_window <= 0 ||
+                stream.response_offset >= stream.response.size()) {
+                continue;
+            }
+            if (next != nullptr && stream.vtime >= next->vtime) continue;
+            if (blocked_by_parent(stream)) continue;
+            next_id = id;
+            next = &stream;
+        }
+        if (next == nullptr) break;
+
+        size_t remaining = next->response.size() - next->response_offset;
+        size_t length = std::min<int64_t>(
+            {static_cast<int64_t>(remaining), connection_send_window_,
+             next->send_window, max_send_frame_});
+
+        bool end_stream = length == remaining;
+        write_frame(FrameType::kData, end_stream ? flags::kEndStream : 0,
+                    next_id,
+                    std::string_view(next->response)
+                        .substr(next->response_offset, length),
+                    &out_);
+
+        next->response_offset += length;
+        next->send_window -= static_cast<int64_t>(length);
+        connection_send_window_ -= static_cast<int64_t>(length);
+
+        vtime_ = std::max(vtime_, next->vtime);
+        next->vtime = vtime_ + length * 256 / next->weight;
+
+        if (end_stream) streams_.erase(next_id);
+    }
+}
+
+// ** output helpers **
+
+void Session::reset_stream(uint32_t stream_id, ErrorCode code) {
+    std::string payload;
+    write_u32(static_cast<uint32_t>(code), &payload);
+    write_frame(FrameType::kRstStream, 0, stream_id, payload, &out_);
+    streams_.erase(stream_id);
+}
+
+bool Session::connection_error(ErrorCode code) {
+    write_goaway(code);
+    failed_ = true;
+    return false;
+}
+
+void Session::write_window_update(uint32_t stream_id, uint32_t increment) {
+    std::string payload;
+    write_u32(increment, &payload);
+    write_frame(FrameType::kWindowUpdate, 0, stream_id, payload, &out_);
+}
+
+void Session::write_goaway(ErrorCode code) {
+    std::string payload;
+    write_u32(last_stream_id_, &payload);
+    write_u32(static_cast<uint32_t>(code), &payload);
+    write_frame(FrameType::kGoAway, 0, 0, payload, &out_);
+    goaway_sent_ = true;
+}
+
+}  // namespace brick::http2
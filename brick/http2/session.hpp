@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "brick/http2/frame.hpp"
+#include "brick/http2/hpack.hpp"
+#include "brick/request/request.hpp"
+#include "brick/response/response.hpp"
+
+namespace brick::http2 {
+
+/**
+ * Server side of one HTTP/2 connection.
+ *
+ * The session is transport-agnostic: the server feeds it received bytes and
+ * writes out whatever it produces. Each request is handed to `dispatch` as
+ * soon as its stream has been half-closed by the client (handlers are
+ * synchronous, exactly as for HTTP/1.1), and the response is queued on the
+ * stream. DATA frames are then scheduled across streams by weighted fair
+ * queuing, respecting stream dependencies and both connection- and
+ * stream-level flow control.
+ */
+class Session {
+   public:
+    using Dispatch = std::function<Response(Request&)>;
+
+    /**
+     * @brief Constructor for Session (queues the server connection preface)
+     * @param `dispatch` called once per request to produce its response
+     */
+    explicit Session(Dispatch dispatch);
+
+    /**
+     * @brief Start from an HTTP/1.1 `Upgrade: h2c` request, which becomes
+     * stream 1. The caller has already sent `101 Switching Protocols`.
+     * @param `request` the request that carried the upgrade
+     * @param `settings` the decoded `HTTP2-Settings` header
+     * @return false if `settings` is malformed
+     */
+    bool upgrade(Request request, std::string_view settings);
+
+    /**
+     * @brief Process received bytes
+     * @param `in` buffered input
+     * @return number of bytes consumed (whole frames only)
+     */
+    size_t receive(std::string_view in);
+
+    /**
+     * @brief Move out all frames produced so far
+     */
+    std::string take_output();
+
+    /**
+     * @brief Stop accepting new streams (graceful GOAWAY); streams already
+     * started are still answered
+     */
+    void go_away();
+
+    /**
+     * @brief Whether the connection can be closed once output is flushed
+     */
+    bool closed() const;
+
+    /**
+     * @brief Check for the client connection preface
+     * @param `in` buffered input
+     * @param `partial` set if `in` is a strict prefix of the preface
+     * @return true if `in` starts with the full preface
+     */
+    static bool is_preface(std::string_view in, bool* partial);
+
+    /**
+     * @brief Decode an `HTTP2-Settings` header value (base64url)
+     * @return false if malformed
+     */
+    static bool decode_settings_header(std::string_view value,
+                                       std::string* out);
+
+    // streams a client may have open at once
+    static constexpr uint32_t kMaxConcurrentStreams = 256;
+    // receive window per stream (advertised) and for the connection
+    static constexpr int64_t kInitialWindow = 1 << 20;
+    // largest request body per stream
+    static constexpr size_t kMaxBodySize = 1 << 20;
+    // largest header block (HEADERS + CONTINUATION)
+    static constexpr size_t kMaxHeaderBlock = 64 * 1024;
+    // largest decoded header list (SETTINGS_MAX_HEADER_LIST_SIZE, advertised)
+    static constexpr uint32_t kMaxHeaderList = 64 * 1024;
+
+   private:
+    struct Stream {
+        HeaderList headers;
+        std::string body;
+        bool request_done = false;
+
+        // response body still to be sent as DATA
+        std::string response;
+        size_t response_offset = 0;
+        bool responded = false;
+
+        int64_t send_window = kDefaultWindow;
+        int64_t unacked_receive = 0;
+
+        // priority: parent stream, weight (1-256) and virtual finish time
+        uint32_t parent = 0;
+        uint32_t weight = 16;
+        uint64_t vtime = 0;
+    };
+
+    bool handle_frame(const FrameHeader& header, std::string_view payload);
+    bool handle_data(const FrameHeader& header, std::string_view payload);
+    bool handle_headers(const FrameHeader& header, std::string_view payload);
+    bool handle_continuation(const FrameHeader& header,
+                             std::string_view payload);
+    bool finish_headers();
+    bool handle_priority(const FrameHeader& header, std::string_view payload);
+    bool handle_rst_stream(const FrameHeader& header,
+                           std::string_view payload);
+    bool handle_settings(const FrameHeader& header, std::string_view payload);
+    bool apply_settings(std::string_view payload);
+    bool handle_ping(const FrameHeader& header, std::string_view payload);
+    bool handle_goaway(const FrameHeader& header, std::string_view payload);
+    bool handle_window_update(const FrameHeader& header,
+                              std::string_view payload);
+
+    static bool strip_padding(const FrameHeader& header,
+                              std::string_view* payload);
+    // false if the stream was reset (and erased) instead
+    bool set_priority(uint32_t stream_id, Stream& stream,
+                      std::string_view priority);
+    // whether `ancestor` is above `stream_id` in the dependency tree
+    bool depends_on(uint32_t stream_id, uint32_t ancestor) const;
+
+    void dispatch(uint32_t stream_id, Stream& stream);
+    void respond(uint32_t stream_id, Stream& stream, Response response);
+    bool blocked_by_parent(const Stream& stream) const;
+    void schedule();
+
+    void reset_stream(uint32_t stream_id, ErrorCode code);
+    bool connection_error(ErrorCode code);
+    void write_window_update(uint32_t stream_id, uint32_t increment);
+    void write_goaway(ErrorCode code);
+
+    Dispatch dispatch_;
+    Decoder decoder_;
+    Encoder encoder_;
+    std::string out_;
+
+    std::unordered_map<uint32_t, Stream> streams_;
+    uint32_t last_stream_id_ = 0;
+
+    // header block being reassembled from CONTINUATION frames
+    std::string header_block_;
+    uint32_t header_stream_id_ = 0;
+    bool header_end_stream_ = false;
+    std::string header_priority_;
+
+    bool preface_received_ = false;
+    bool goaway_sent_ = false;
+    bool failed_ = false;
+    bool peer_goaway_ = false;
+
+    // peer settings
+    int64_t initial_send_window_ = kDefaultWindow;
+    uint32_t max_send_frame_ = kDefaultMaxFrameSize;
+
+    int64_t connection_send_window_ = kDefaultWindow;
+    int64_t connection_unacked_receive_ = 0;
+    // virtual time of the last scheduled DATA frame
+    uint64_t vtime_ = 0;
+};
+
+}  // namespace brick::http2
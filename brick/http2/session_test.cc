@@ -0,0 +1,235 @@
+#include "brick/http2/session.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace brick::http2 {
+namespace {
+
+// ":method: GET", ":path: /", ":scheme: http" as static-table references
+constexpr std::string_view kGetRoot = "\x82\x84\x86";
+
+struct Frame {
+    FrameHeader header;
+    std::string payload;
+};
+
+std::vector<Frame> parse_frames(std::string_view out) {
+    std::vector<Frame> frames;
+    FrameHeader header;
+    while (parse_frame_header(out, &header)) {
+        frames.push_back(
+            {header, std::string(out.substr(kFrameHeaderSize, header.length))});
+        out.remove_prefix(kFrameHeaderSize + header.length);
+    }
+    return frames;
+}
+
+// a PRIORITY payload (also the HEADERS priority fields)
+std::string priority(uint32_t parent, bool exclusive = false,
+                     uint8_t weight = 15) {
+    std::string payload;
+    write_u32(parent | (exclusive ? 0x80000000 : 0), &payload);
+    payload.push_back(static_cast<char>(weight));
+    return payload;
+}
+
+class SessionTest : public ::testing::Test {
+   protected:
+    SessionTest()
+        : session_([this](Request& request) {
+              paths_.push_back(request.route());
+              Response response(200);
+              response.set_body(body_);
+              for (const std::string& cookie : cookies_) {
+                  response.add_header("Set-Cookie", cookie);
+              }
+              return response;
+          }) {
+        session_.take_output();  // our preface
+        input_ = kClientPreface;
+    }
+
+    void frame(FrameType type, uint8_t frame_flags, uint32_t stream_id,
+               std::string_view payload) {
+        write_frame(type, frame_flags, stream_id, payload, &input_);
+    }
+
+    // feed everything queued so far; returns the frames sent back
+    std::vector<Frame> exchange() {
+        EXPECT_EQ(session_.receive(input_), input_.size());
+        input_.clear();
+        return parse_frames(session_.take_output());
+    }
+
+    static const Frame* find(const std::vector<Frame>& frames, FrameType type,
+                             uint32_t stream_id) {
+        for (const Frame& frame : frames) {
+            if (frame.header.type == type &&
+                frame.header.stream_id == stream_id) {
+                return &frame;
+            }
+        }
+        return nullptr;
+    }
+
+    Session session_;
+    std::string input_;
+    std::vector<std::string> paths_;
+    std::string body_;
+    std::vector<std::string> cookies_;
+};
+
+TEST_F(SessionTest, AnswersRequest) {
+    frame(FrameType::kHeaders, flags::kEndStream | flags::kEndHeaders, 1,
+          kGetRoot);
+    std::vector<Frame> frames = exchange();
+
+    ASSERT_EQ(paths_.size(), 1);
+    EXPECT_EQ(paths_[0], "/");
+    const Frame* headers = find(frames, FrameType::kHeaders, 1);
+    ASSERT_NE(headers, nullptr);
+    EXPECT_TRUE(headers->header.flags & flags::kEndStream);
+}
+
+TEST_F(SessionTest, SendsRepeatedFieldsSeparately) {
+    cookies_ = {"a=1", "b=2"};
+    frame(FrameType::kHeaders, flags::kEndStream | flags::kEndHeaders, 1,
+          kGetRoot);
+    std::vector<Frame> frames = exchange();
+
+    const Frame* headers = find(frames, FrameType::kHeaders, 1);
+    ASSERT_NE(headers, nullptr);
+    HeaderList fields;
+    Decoder decoder;
+    ASSERT_EQ(decoder.decode(headers->payload, &fields), DecodeResult::kOk);
+    std::vector<std::string> cookies;
+    for (const auto& [name, value] : fields) {
+        if (name == "set-cookie") cookies.push_back(value);
+    }
+    EXPECT_EQ(cookies, cookies_);
+}
+
+TEST_F(SessionTest, SelfDependentHeadersResetStream) {
+    // END_STREAM | END_HEADERS | PRIORITY, depending on itself
+    frame(FrameType::kHeaders, 0x25, 1, priority(1) + std::string(kGetRoot));
+    std::vector<Frame> frames = exchange();
+
+    EXPECT_TRUE(paths_.empty());
+    const Frame* reset = find(frames, FrameType::kRstStream, 1);
+    ASSERT_NE(reset, nullptr);
+    EXPECT_EQ(read_u32(reset->payload),
+              static_cast<uint32_t>(ErrorCode::kProtocolError));
+    EXPECT_EQ(find(frames, FrameType::kGoAway, 0), nullptr);
+    EXPECT_FALSE(session_.closed());
+}
+
+TEST_F(SessionTest, SelfDependentPriorityResetsStream) {
+    frame(FrameType::kHeaders, flags::kEndHeaders, 1, kGetRoot);
+    frame(FrameType::kPriority, 0, 1, priority(1));
+    std::vector<Frame> frames = exchange();
+
+    EXPECT_NE(find(frames, FrameType::kRstStream, 1), nullptr);
+    EXPECT_FALSE(session_.closed());
+}
+
+TEST_F(SessionTest, DependencyOnDescendantMovesItUp) {
+    // 3 depends on 1, then 1 is made to depend on 3: 3 first takes 1's old
+    // place under the root instead of both waiting on each other forever
+    body_ = "hello";
+    frame(FrameType::kHeaders, flags::kEndHeaders, 1, kGetRoot);
+    frame(FrameType::kHeaders, 0x24, 3, priority(1) + std::string(kGetRoot));
+    frame(FrameType::kPriority, 0, 1, priority(3));
+    frame(FrameType::kData, flags::kEndStream, 1, "");
+    frame(FrameType::kData, flags::kEndStream, 3, "");
+    std::vector<Frame> frames = exchange();
+
+    EXPECT_EQ(paths_.size(), 2);
+    std::vector<uint32_t> sent;
+    for (const Frame& frame : frames) {
+        if (frame.header.type == FrameType::kData) {
+            EXPECT_EQ(frame.payload, "hello");
+            sent.push_back(frame.header.stream_id);
+        }
+    }
+    EXPECT_EQ(sent, (std::vector<uint32_t>{3, 1}));
+}
+
+TEST_F(SessionTest, ExclusiveDependencyAdoptsSiblings) {
+    // two DATA frames per response
+    body_.assign(kDefaultMaxFrameSize + 1, 'a');
+    for (uint32_t id : {1, 3, 5}) {
+        frame(FrameType::kHeaders, flags::kEndHeaders, id, kGetRoot);
+    }
+    // 5 becomes the only child of the root, with 1 and 3 below it: even at
+    // the lowest weight it sends its whole response first
+    frame(FrameType::kPriority, 0, 5, priority(0, true, 0));
+    for (uint32_t id : {1, 3, 5}) {
+        frame(FrameType::kData, flags::kEndStream, id, "");
+    }
+    std::vector<Frame> frames = exchange();
+
+    std::vector<uint32_t> sent;
+    for (const Frame& frame : frames) {
+        if (frame.header.type == FrameType::kData) {
+            sent.push_back(frame.header.stream_id);
+        }
+    }
+    ASSERT_EQ(sent.size(), 6);
+    EXPECT_EQ(sent[0], 5);
+    EXPECT_EQ(sent[1], 5);
+}
+
+TEST_F(SessionTest, RepeatedTableReferencesEndConnection) {
+    // one ~4KB dynamic table entry, then referenced with one byte (index 62)
+    // until the block is 64KB: a ~250MB header list if it were expanded
+    std::string block(kGetRoot);
+    // literal with incremental indexing, new name "x-a", 4000-byte value
+    // (7-bit prefix 127 + varint 3873)
+    block += "\x40\x03x-a\x7f\xa1\x1e";
+    block.append(4000, 'a');
+    block.append(Session::kMaxHeaderBlock - block.size(), '\xbe');
+
+    std::string_view rest(block);
+    FrameType type = FrameType::kHeaders;
+    while (!rest.empty()) {
+        std::string_view fragment = rest.substr(0, kDefaultMaxFrameSize);
+        rest.remove_prefix(fragment.size());
+        uint8_t frame_flags = rest.empty() ? flags::kEndHeaders : 0;
+        if (type == FrameType::kHeaders) frame_flags |= flags::kEndStream;
+        frame(type, frame_flags, 1, fragment);
+        type = FrameType::kContinuation;
+    }
+    std::vector<Frame> frames = exchange();
+
+    EXPECT_TRUE(paths_.empty());
+    const Frame* goaway = find(frames, FrameType::kGoAway, 0);
+    ASSERT_NE(goaway, nullptr);
+    EXPECT_EQ(read_u32(std::string_view(goaway->payload).substr(4)),
+              static_cast<uint32_t>(ErrorCode::kEnhanceYourCalm));
+    EXPECT_TRUE(session_.closed());
+}
+
+TEST(SessionPrefaceTest, AdvertisesHeaderListLimit) {
+    Session session([](Request&) { return Response(200); });
+    std::vector<Frame> frames = parse_frames(session.take_output());
+
+    ASSERT_FALSE(frames.empty());
+    ASSERT_EQ(frames[0].header.type, FrameType::kSettings);
+    std::string_view settings = frames[0].payload;
+    bool found = false;
+    for (size_t i = 0; i + 6 <= settings.size(); i += 6) {
+        if (settings[i] == 0 && settings[i + 1] == 6) {
+            found = true;
+            EXPECT_EQ(read_u32(settings.substr(i + 2)),
+                      Session::kMaxHeaderList);
+        }
+    }
+    EXPECT_TRUE(found);
+}
+
+}  // namespace
+}  // namespace brick::http2
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * Byte scanners shared by the JSON reader and writer: each finds the first
+ * byte of some class, 16 bytes per step with SSE2 (part of the x86-64
+ * baseline, so no build flags are needed) and bytewise elsewhere and for the
+ * tail.
+ */
+
+namespace brick::json::scan {
+
+#if defined(__SSE2__)
+// inside a document the next hit is usually only a few bytes away (short
+// keys, punctuation), where a bytewise check beats setting up a vector
+// compare; longer runs go 16 bytes at a time
+constexpr int kScalarPrefix = 8;
+
+// bit i set if byte i of `chunk` equals `c`
+inline int matches(__m128i chunk, char c) {
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(c)));
+}
+#endif
+
+/**
+ * @brief Find the first '"' or '\' (the end of a string's plain run)
+ * @return its position, or `end`
+ */
+inline const char* quote_or_backslash(const char* p, const char* end) {
+#if defined(__SSE2__)
+    for (int i = 0; i < kScalarPrefix && p < end; i++, p++) {
+        if (*p == '"' || *p == '\\') return p;
+    }
+    for (; end - p >= 16; p += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int mask = matches(chunk, '"') | matches(chunk, '\\');
+        if (mask != 0) return p + __builtin_ctz(mask);
+    }
+#endif
+    for (; p < end; p++) {
+        if (*p == '"' || *p == '\\') return p;
+    }
+    return end;
+}
+
+/**
+ * @brief Find the first byte that starts a string or opens or closes a
+ * container ('"', '[', ']', '{', '}')
+ * @return its position, or `end`
+ */
+inline const char* structural(const char* p, const char* end) {
+#if defined(__SSE2__)
+    for (int i = 0; i < kScalarPrefix && p < end; i++, p++) {
+        char c = *p;
+        if (c == '"' || c == '[' || c == ']' || c == '{' || c == '}') return p;
+    }
+    for (; end - p >= 16; p += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int mask = matches(chunk, '"') | matches(chunk, '[') |
+                   matches(chunk, ']') | matches(chunk, '{') |
+                   matches(chunk, '}');
+        if (mask != 0) return p + __builtin_ctz(mask);
+    }
+#endif
+    for (; p < end; p++) {
+        char c = *p;
+        if (c == '"' || c == '[' || c == ']' || c == '{' || c == '}') return p;
+    }
+    return end;
+}
+
+/**
+ * @brief Find the first byte a JSON string must escape ('"', '\' or a
+ * control character)
+ * @return its position, or `end`
+ */
+inline const char* needs_escape(const char* p, const char* end) {
+#if defined(__SSE2__)
+    for (; end - p >= 16; p += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        // unsigned c <= 0x1F  <=>  max(c, 0x1F) == 0x1F
+        __m128i limit = _mm_set1_epi8(0x1F);
+        int control = _mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_max_epu8(chunk, limit), limit));
+        int mask = control | matches(chunk, '"') | matches(chunk, '\\');
+        if (mask != 0) return p + __builtin_ctz(mask);
+    }
+#endif
+    for (; p < end; p++) {
+        auto c = static_cast<uint8_t>(*p);
+        if (c < 0x20 || c == '"' || c == '\\') return p;
+    }
+    return end;
+}
+
+}  // namespace brick::json::scan
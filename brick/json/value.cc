@@ -0,0 +1,321 @@
+#include "value.hpp"
+
+#include <charconv>
+
+#include "brick/json/scan.hpp"
+
+namespace brick::json {
+
+namespace {
+
+bool is_space(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+const char* skip_space(const char* p, const char* end) {
+    while (p < end && is_space(*p)) p++;
+    return p;
+}
+
+// whether a value can start with `c` (anything else is an empty or
+// malformed element, like the second one in `[1,,2]`)
+bool starts_value(char c) {
+    return c == '"' || c == '[' || c == '{' || c == '-' || c == 't' ||
+           c == 'f' || c == 'n' || (c >= '0' && c <= '9');
+}
+
+// end of a scalar (number or literal): the next delimiter
+const char* scalar_end(const char* p, const char* end) {
+    while (p < end && *p != ',' && *p != ']' && *p != '}' && *p != ':' &&
+           !is_space(*p)) {
+        p++;
+    }
+    return p;
+}
+
+// `p` is just past the opening quote; returns just past the closing quote,
+// or nullptr if the string is unterminated
+const char* skip_string(const char* p, const char* end) {
+    while (true) {
+        p = scan::quote_or_backslash(p, end);
+        if (p == end) return nullptr;
+        if (*p == '"') return p + 1;
+        p += 2;  // the escaped byte can't end the string
+        if (p > end) return nullptr;
+    }
+}
+
+// `p` is the first byte of a value; returns just past it, or nullptr if it
+// is malformed. Containers are only checked for balance, not syntax.
+const char* skip_value(const char* p, const char* end) {
+    if (p >= end) return nullptr;
+    if (*p == '"') return skip_string(p + 1, end);
+    if (*p != '[' && *p != '{') {
+        const char* token_end = scalar_end(p, end);
+        return token_end != p ? token_end : nullptr;
+    }
+
+    size_t depth = 0;
+    while (true) {
+        p = scan::structural(p, end);
+        if (p == end) return nullptr;
+        switch (*p) {
+            case '"':
+                p = skip_string(p + 1, end);
+                if (p == nullptr) return nullptr;
+                continue;
+            case '[':
+            case '{':
+                depth++;
+                break;
+            default:  // ']' or '}'
+                if (--depth == 0) return p + 1;
+        }
+        p++;
+    }
+}
+
+// `p` is just past an element; returns the next one's first byte, or
+// nullptr if the container ends (or is malformed)
+const char* next_element(const char* p, const char* end) {
+    p = skip_space(p, end);
+    if (p == end || *p != ',') return nullptr;
+    p = skip_space(p + 1, end);
+    if (p == end || !starts_value(*p)) return nullptr;
+    return p;
+}
+
+void append_utf8(uint32_t code, std::string* out) {
+    if (code < 0x80) {
+        out->push_back(static_cast<char>(code));
+    } else if (code < 0x800) {
+        out->push_back(static_cast<char>(0xC0 | code >> 6));
+        out->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else if (code < 0x10000) {
+        out->push_back(static_cast<char>(0xE0 | code >> 12));
+        out->push_back(static_cast<char>(0x80 | (code >> 6 & 0x3F)));
+        out->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else {
+        out->push_back(static_cast<char>(0xF0 | code >> 18));
+        out->push_back(static_cast<char>(0x80 | (code >> 12 & 0x3F)));
+        out->push_back(static_cast<char>(0x80 | (code >> 6 & 0x3F)));
+        out->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    }
+}
+
+// four hex digits at `p`
+std::optional<uint32_t> parse_hex4(const char* p, const char* end) {
+    if (end - p < 4) return std::nullopt;
+    uint32_t code;
+    auto [ptr, ec] = std::from_chars(p, p + 4, code, 16);
+    if (ec != std::errc() || ptr != p + 4) return std::nullopt;
+    return code;
+}
+
+}  // namespace
+
+Value Value::parse(std::string_view document) {
+    const char* end = document.data() + document.size();
+    const char* p = skip_space(document.data(), end);
+    return p < end ? Value(p, end) : Value();
+}
+
+Type Value::type() const {
+    if (begin_ == nullptr) return Type::kInvalid;
+    switch (*begin_) {
+        case '{':
+            return Type::kObject;
+        case '[':
+            return Type::kArray;
+        case '"':
+            return Type::kString;
+        case 't':
+        case 'f':
+            return Type::kBool;
+        case 'n':
+            return Type::kNull;
+        case '-':
+            return Type::kNumber;
+        default:
+            return *begin_ >= '0' && *begin_ <= '9' ? Type::kNumber
+                                                    : Type::kInvalid;
+    }
+}
+
+Value Value::operator[](std::string_view key) const {
+    for (auto [name, value] : members()) {
+        if (name == key) return value;
+    }
+    return Value();
+}
+
+Value Value::operator[](size_t index) const {
+    for (Value item : items()) {
+        if (index-- == 0) return item;
+    }
+    return Value();
+}
+
+std::string_view Value::token() const {
+    if (begin_ == nullptr) return {};
+    return std::string_view(begin_, scalar_end(begin_, end_) - begin_);
+}
+
+bool Value::is_null() const { return token() == "null"; }
+
+std::optional<bool> Value::as_bool() const {
+    std::string_view literal = token();
+    if (literal == "true") return true;
+    if (literal == "false") return false;
+    return std::nullopt;
+}
+
+std::optional<int64_t> Value::as_int() const {
+    if (type() != Type::kNumber) return std::nullopt;
+    std::string_view number = token();
+    int64_t value;
+    auto [ptr, ec] =
+        std::from_chars(number.data(), number.data() + number.size(), value);
+    if (ec != std::errc() || ptr != number.data() + number.size()) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+std::optional<double> Value::as_double() const {
+    if (type() != Type::kNumber) return std::nullopt;
+    std::string_view number = token();
+    double value;
+    auto [ptr, ec] =
+        std::from_chars(number.data(), number.data() + number.size(), value);
+    if (ec != std::errc() || ptr != number.data() + number.size()) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+std::optional<std::string_view> Value::as_raw_string() const {
+    if (type() != Type::kString) return std::nullopt;
+    const char* string_end = skip_string(begin_ + 1, end_);
+    if (string_end == nullptr) return std::nullopt;
+    return std::string_view(begin_ + 1, string_end - begin_ - 2);
+}
+
+std::optional<std::string> Value::as_string() const {
+    if (type() != Type::kString) return std::nullopt;
+
+    std::string out;
+    const char* p = begin_ + 1;
+    while (true) {
+        // copy plain runs whole
+        const char* run_end = scan::quote_or_backslash(p, end_);
+        out.append(p, run_end);
+        p = run_end;
+        if (p == end_) return std::nullopt;
+        if (*p == '"') return out;
+        if (end_ - p < 2) return std::nullopt;
+
+        char escaped = p[1];
+        p += 2;
+        switch (escaped) {
+            case '"':
+            case '\\':
+            case '/':
+                out.push_back(escaped);
+                break;
+            case 'b':
+                out.push_back('\b');
+                break;
+            case 'f':
+                out.push_back('\f');
+                break;
+            case 'n':
+                out.push_back('\n');
+                break;
+            case 'r':
+                out.push_back('\r');
+                break;
+            case 't':
+                out.push_back('\t');
+                break;
+            case 'u': {
+                std::optional<uint32_t> code = parse_hex4(p, end_);
+                if (!code) return std::nullopt;
+                p += 4;
+                // a surrogate pair encodes one code point above U+FFFF
+                if (*code >= 0xD800 && *code < 0xDC00 && end_ - p >= 6 &&
+                    p[0] == '\\' && p[1] == 'u') {
+                    std::optional<uint32_t> low = parse_hex4(p + 2, end_);
+                    if (low && *low >= 0xDC00 && *low < 0xE000) {
+                        code = 0x10000 + ((*code - 0xD800) << 10) +
+                               (*low - 0xDC00);
+                        p += 6;
+                    }
+                }
+                append_utf8(*code, &out);
+                break;
+            }
+            default:
+                return std::nullopt;
+        }
+    }
+}
+
+std::string_view Value::raw() const {
+    if (begin_ == nullptr) return {};
+    const char* value_end = skip_value(begin_, end_);
+    if (value_end == nullptr) return {};
+    return std::string_view(begin_, value_end - begin_);
+}
+
+Items Value::items() const {
+    return Items(type() == Type::kArray ? *this : Value());
+}
+
+Members Value::members() const {
+    return Members(type() == Type::kObject ? *this : Value());
+}
+
+Items::iterator Items::begin() const {
+    if (array_.begin_ == nullptr) return end();
+    const char* end = array_.end_;
+    const char* p = skip_space(array_.begin_ + 1, end);
+    if (p == end || !starts_value(*p)) return this->end();
+    return iterator(p, end);
+}
+
+Items::iterator& Items::iterator::operator++() {
+    const char* value_end = skip_value(p_, end_);
+    p_ = value_end != nullptr ? next_element(value_end, end_) : nullptr;
+    return *this;
+}
+
+Members::iterator Members::begin() const {
+    if (object_.begin_ == nullptr) return end();
+    const char* end = object_.end_;
+    const char* p = skip_space(object_.begin_ + 1, end);
+    return iterator(p, end);
+}
+
+void Members::iterator::read(const char* p) {
+    value_ = nullptr;
+    if (p == nullptr || p == end_ || *p != '"') return;
+
+    const char* key_end = skip_string(p + 1, end_);
+    if (key_end == nullptr) return;
+    const char* colon = skip_space(key_end, end_);
+    if (colon == end_ || *colon != ':') return;
+    const char* value = skip_space(colon + 1, end_);
+    if (value == end_ || !starts_value(*value)) return;
+
+    key_ = std::string_view(p + 1, key_end - p - 2);
+    value_ = value;
+}
+
+Members::iterator& Members::iterator::operator++() {
+    const char* value_end = skip_value(value_, end_);
+    read(value_end != nullptr ? next_element(value_end, end_) : nullptr);
+    return *this;
+}
+
+}  // namespace brick::json
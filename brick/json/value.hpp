@@ -0,0 +1,198 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+/**
+ * Lazy, read-only JSON access over a buffer (e.g. `Request::body_view()`).
+ *
+ * Nothing is parsed up front and nothing is allocated: a `Value` is a
+ * position in the document, and each lookup scans forward from it, skipping
+ * the values it doesn't need (16 bytes at a time, see scan.hpp). Handlers
+ * typically read a few fields of a small body once, which is exactly what
+ * this is fast at; reading every field of a large document repeatedly
+ * re-scans it, so copy out what is used more than once.
+ *
+ * The document is only checked as far as it is read: a lookup into a
+ * malformed part yields an invalid `Value` (and scalar accessors
+ * `std::nullopt`), never an exception. Values point into the buffer, which
+ * must outlive them.
+ *
+ * Usage:
+ *       auto body = brick::json::Value::parse(request.body_view());
+ *       std::optional<int64_t> id = body["user"]["id"].as_int();
+ *       for (brick::json::Value tag : body["tags"].items()) { ... }
+ *       for (auto [key, value] : body["labels"].members()) { ... }
+ */
+
+namespace brick::json {
+
+enum class Type { kInvalid, kNull, kBool, kNumber, kString, kArray, kObject };
+
+class Items;
+class Members;
+
+class Value {
+   public:
+    // an invalid value
+    Value() = default;
+
+    /**
+     * @brief Start reading a document
+     * @param `document` the JSON text (not copied)
+     * @return the top-level value (invalid if the document is empty)
+     */
+    static Value parse(std::string_view document);
+
+    /**
+     * @brief Get the type, from the value's first byte (the value itself is
+     * not checked)
+     */
+    Type type() const;
+
+    bool valid() const { return type() != Type::kInvalid; }
+
+    /**
+     * @brief Look up an object member; keys are compared as written, so
+     * escape sequences in the document's keys are not decoded
+     * @return the member's value (invalid if this is not an object or the key
+     * is missing)
+     */
+    Value operator[](std::string_view key) const;
+
+    /**
+     * @brief Look up an array element
+     * @return the element (invalid if this is not an array or too short)
+     */
+    Value operator[](size_t index) const;
+
+    bool is_null() const;
+    std::optional<bool> as_bool() const;
+
+    /**
+     * @brief Read an integer (numbers with a fraction or exponent, or out of
+     * range, are std::nullopt)
+     */
+    std::optional<int64_t> as_int() const;
+    std::optional<double> as_double() const;
+
+    /**
+     * @brief Read a string without decoding it: no copy, but escape sequences
+     * are left as they are in the document
+     */
+    std::optional<std::string_view> as_raw_string() const;
+
+    /**
+     * @brief Read and decode a string
+     */
+    std::optional<std::string> as_string() const;
+
+    /**
+     * @brief Get the JSON text of the value (e.g. to store or forward it)
+     * @return the text, or empty if the value is invalid or malformed
+     */
+    std::string_view raw() const;
+
+    /**
+     * @brief Iterate over an array's elements (none if this is not an array)
+     */
+    Items items() const;
+
+    /**
+     * @brief Iterate over an object's members (none if this is not an
+     * object)
+     */
+    Members members() const;
+
+   private:
+    friend class Items;
+    friend class Members;
+
+    Value(const char* begin, const char* end) : begin_(begin), end_(end) {}
+
+    // end of the scalar starting at `begin_`
+    std::string_view token() const;
+
+    // first byte of the value, and the end of the document
+    const char* begin_ = nullptr;
+    const char* end_ = nullptr;
+};
+
+struct Member {
+    // as written in the document (escape sequences are not decoded)
+    std::string_view key;
+    Value value;
+};
+
+/**
+ * @brief Forward range over an array's elements; iteration stops early at a
+ * malformed element
+ */
+class Items {
+   public:
+    class iterator {
+       public:
+        Value operator*() const { return Value(p_, end_); }
+        iterator& operator++();
+        bool operator==(const iterator& other) const { return p_ == other.p_; }
+
+       private:
+        friend class Items;
+        iterator(const char* p, const char* end) : p_(p), end_(end) {}
+
+        // first byte of the current element; nullptr at the end
+        const char* p_;
+        const char* end_;
+    };
+
+    iterator begin() const;
+    iterator end() const { return iterator(nullptr, nullptr); }
+
+   private:
+    friend class Value;
+    explicit Items(Value array) : array_(array) {}
+
+    Value array_;
+};
+
+/**
+ * @brief Forward range over an object's members; iteration stops early at a
+ * malformed member
+ */
+class Members {
+   public:
+    class iterator {
+       public:
+        Member operator*() const { return {key_, Value(value_, end_)}; }
+        iterator& operator++();
+        bool operator==(const iterator& other) const {
+            return value_ == other.value_;
+        }
+
+       private:
+        friend class Members;
+        iterator(const char* p, const char* end) : end_(end) { read(p); }
+
+        // parse the member starting at `p` (a '"'), or end the iteration
+        void read(const char* p);
+
+        std::string_view key_;
+        // first byte of the current member's value; nullptr at the end
+        const char* value_ = nullptr;
+        const char* end_;
+    };
+
+    iterator begin() const;
+    iterator end() const { return iterator(nullptr, nullptr); }
+
+   private:
+    friend class Value;
+    explicit Members(Value object) : object_(object) {}
+
+    Value object_;
+};
+
+}  // namespace brick::json
@@ -0,0 +1,145 @@
+#include "brick/json/value.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace brick::json {
+namespace {
+
+// a copy with nothing after it, so reads past the document trip ASan
+struct Document {
+    explicit Document(std::string_view text)
+        : bytes(text.begin(), text.end()),
+          value(Value::parse(std::string_view(bytes.data(), bytes.size()))) {}
+
+    std::vector<char> bytes;
+    Value value;
+};
+
+size_t count_items(Value value) {
+    size_t count = 0;
+    for (Value item : value.items()) {
+        (void)item;
+        count++;
+    }
+    return count;
+}
+
+size_t count_members(Value value) {
+    size_t count = 0;
+    for (auto member : value.members()) {
+        (void)member;
+        count++;
+    }
+    return count;
+}
+
+TEST(JsonValueTest, ReadsWellFormedDocument) {
+    Document doc(
+        R"({"id": 42, "name": "a\"bé😀", "tags": ["x", "y"],
+            "ok": true, "none": null, "ratio": -1.5e2})");
+    EXPECT_EQ(doc.value["id"].as_int(), 42);
+    EXPECT_EQ(doc.value["name"].as_string(), "a\"b\xc3\xa9\xf0\x9f\x98\x80");
+    EXPECT_EQ(count_items(doc.value["tags"]), 2);
+    EXPECT_EQ(doc.value["tags"][1].as_string(), "y");
+    EXPECT_EQ(doc.value["ok"].as_bool(), true);
+    EXPECT_TRUE(doc.value["none"].is_null());
+    EXPECT_EQ(doc.value["ratio"].as_double(), -150);
+    EXPECT_EQ(doc.value["tags"].raw(), R"(["x", "y"])");
+    EXPECT_EQ(count_members(doc.value), 6);
+}
+
+TEST(JsonValueTest, EmptyDocumentIsInvalid) {
+    for (std::string_view text : {"", "   \n\t"}) {
+        Document doc(text);
+        EXPECT_FALSE(doc.value.valid());
+        EXPECT_FALSE(doc.value["a"].valid());
+        EXPECT_FALSE(doc.value[size_t{0}].valid());
+        EXPECT_EQ(count_items(doc.value), 0);
+        EXPECT_EQ(count_members(doc.value), 0);
+        EXPECT_EQ(doc.value.raw(), "");
+    }
+}
+
+TEST(JsonValueTest, RejectsMalformedScalars) {
+    for (std::string_view text :
+         {"-", "--1", "1.2.3", "0x10", "1e", "+1", "nul", "nullx", "tru",
+          "truefalse", "99999999999999999999"}) {
+        Document doc(text);
+        EXPECT_EQ(doc.value.as_int(), std::nullopt) << text;
+        EXPECT_FALSE(doc.value.as_bool()) << text;
+        EXPECT_FALSE(doc.value.is_null()) << text;
+        EXPECT_FALSE(doc.value.as_string()) << text;
+    }
+    EXPECT_EQ(Document("1.5").value.as_int(), std::nullopt);
+    EXPECT_EQ(Document("1e400").value.as_double(), std::nullopt);
+}
+
+TEST(JsonValueTest, RejectsMalformedStrings) {
+    for (std::string_view text :
+         {R"(")", R"("abc)", R"("abc\)", R"("abc\")", R"("\x")", R"("\u12")",
+          R"("\u12g4")", R"("\u)", R"("\ud83d\u)"}) {
+        Document doc(text);
+        EXPECT_FALSE(doc.value.as_string()) << text;
+    }
+    // unterminated: there is no end to give a raw view of either
+    for (std::string_view text : {R"(")", R"("abc)", R"("abc\)", R"("abc\")"}) {
+        Document doc(text);
+        EXPECT_EQ(doc.value.raw(), "") << text;
+        EXPECT_FALSE(doc.value.as_raw_string()) << text;
+    }
+}
+
+TEST(JsonValueTest, StopsAtMalformedContainers) {
+    // truncated anywhere: lookups stop at the end of the buffer (only the
+    // parts read are checked, so the members before the cut still work)
+    std::string_view full = R"({"a": [1, {"b": "c\"d"}], "e": 2})";
+    for (size_t length = 0; length < full.size(); length++) {
+        Document doc(full.substr(0, length));
+        EXPECT_EQ(doc.value.raw(), "") << length;
+        (void)doc.value["e"].as_int();
+        (void)doc.value["a"][1]["b"].as_string();
+        count_items(doc.value["a"]);
+        count_members(doc.value);
+    }
+
+    // bad separators end the iteration at the last good element
+    EXPECT_EQ(count_items(Document("[1 2]").value), 1);
+    EXPECT_EQ(count_items(Document("[1,,2]").value), 1);
+    EXPECT_EQ(count_items(Document("[1,]").value), 1);
+    EXPECT_EQ(count_items(Document("[,1]").value), 0);
+    EXPECT_EQ(count_items(Document("[:]").value), 0);
+    EXPECT_EQ(count_members(Document(R"({"a" 1})").value), 0);
+    EXPECT_EQ(count_members(Document(R"({a: 1})").value), 0);
+    EXPECT_EQ(count_members(Document(R"({"a": 1 "b": 2})").value), 1);
+    EXPECT_FALSE(Document(R"({"a": 1 "b": 2})").value["b"].valid());
+
+    // a member without a value
+    EXPECT_FALSE(Document(R"({"a":})").value["a"].valid());
+    EXPECT_FALSE(Document(R"({"a":)").value["a"].valid());
+}
+
+TEST(JsonValueTest, WrongTypesYieldNothing) {
+    Document doc(R"({"n": 1, "s": "x", "a": [1], "o": {}})");
+    EXPECT_FALSE(doc.value["n"].as_string());
+    EXPECT_FALSE(doc.value["s"].as_int());
+    EXPECT_FALSE(doc.value["a"]["key"].valid());
+    EXPECT_FALSE(doc.value["o"][size_t{0}].valid());
+    EXPECT_EQ(count_items(doc.value["o"]), 0);
+    EXPECT_EQ(count_members(doc.value["a"]), 0);
+    EXPECT_FALSE(doc.value["a"][1].valid());
+}
+
+TEST(JsonValueTest, DeepNestingIsNotRecursive) {
+    std::string text(100000, '[');
+    text.append(100000, ']');
+    Document doc(text);
+    EXPECT_EQ(doc.value.raw().size(), text.size());
+    EXPECT_EQ(count_items(doc.value), 1);
+}
+
+}  // namespace
+}  // namespace brick::json
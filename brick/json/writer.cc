@@ -0,0 +1,127 @@
+#include "writer.hpp"
+
+#include <cmath>
+
+#include "brick/json/scan.hpp"
+
+namespace brick::json {
+
+Writer::Writer(Response& response) : out_(response.mutable_body()) {
+    response.set_header("Content-Type", "application/json");
+}
+
+Writer& Writer::begin_object() {
+    separate();
+    out_.push_back('{');
+    need_comma_ = false;
+    return *this;
+}
+
+Writer& Writer::end_object() {
+    out_.push_back('}');
+    need_comma_ = true;
+    return *this;
+}
+
+Writer& Writer::begin_array() {
+    separate();
+    out_.push_back('[');
+    need_comma_ = false;
+    return *this;
+}
+
+Writer& Writer::end_array() {
+    out_.push_back(']');
+    need_comma_ = true;
+    return *this;
+}
+
+Writer& Writer::key(std::string_view key) {
+    separate();
+    write_string(key);
+    out_.push_back(':');
+    need_comma_ = false;
+    return *this;
+}
+
+Writer& Writer::value(std::string_view value) {
+    separate();
+    write_string(value);
+    return *this;
+}
+
+Writer& Writer::value(bool value) {
+    separate();
+    out_.append(value ? "true" : "false");
+    return *this;
+}
+
+Writer& Writer::value(double value) {
+    if (!std::isfinite(value)) return null();
+    char buf[32];
+    // shortest text that reads back as the same double
+    auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+    separate();
+    out_.append(buf, end);
+    return *this;
+}
+
+Writer& Writer::null() {
+    separate();
+    out_.append("null");
+    return *this;
+}
+
+Writer& Writer::raw(std::string_view json) {
+    separate();
+    out_.append(json);
+    return *this;
+}
+
+void Writer::write_string(std::string_view value) {
+    static constexpr char kHex[] = "0123456789abcdef";
+
+    out_.push_back('"');
+    const char* p = value.data();
+    const char* end = p + value.size();
+    while (true) {
+        // copy plain runs whole
+        const char* run_end = scan::needs_escape(p, end);
+        out_.append(p, run_end);
+        if (run_end == end) break;
+
+        char c = *run_end;
+        p = run_end + 1;
+        switch (c) {
+            case '"':
+                out_.append("\\\"");
+                break;
+            case '\\':
+                out_.append("\\\\");
+                break;
+            case '\b':
+                out_.append("\\b");
+                break;
+            case '\f':
+                out_.append("\\f");
+                break;
+            case '\n':
+                out_.append("\\n");
+                break;
+            case '\r':
+                out_.append("\\r");
+                break;
+            case '\t':
+                out_.append("\\t");
+                break;
+            default: {
+                char escape[] = {'\\', 'u', '0', '0', kHex[c >> 4 & 0xF],
+                                 kHex[c & 0xF]};
+                out_.append(escape, sizeof(escape));
+            }
+        }
+    }
+    out_.push_back('"');
+}
+
+}  // namespace brick::json
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "brick/response/response.hpp"
+
+/**
+ * Streaming JSON output, written straight into a response body (or any
+ * string) as values are added: no intermediate document, and strings are
+ * escaped 16 bytes at a time (see scan.hpp).
+ *
+ * Commas and colons are inserted automatically; nesting is up to the caller
+ * (every `begin_*` needs its `end_*`, and object members need a `key` first).
+ *
+ * Usage:
+ *       brick::Response response(200);
+ *       brick::json::Writer json(response);
+ *       json.begin_object()
+ *           .member("id", 42)
+ *           .key("tags").begin_array().value("a").value("b").end_array()
+ *           .end_object();
+ *       return response;
+ */
+
+namespace brick::json {
+
+class Writer {
+   public:
+    /**
+     * @brief Write into a response's body (appending to what is there) and
+     * set its Content-Type to application/json
+     * @param `response` the response; must outlive the writer
+     */
+    explicit Writer(Response& response);
+
+    /**
+     * @brief Write into (append to) a string
+     * @param `out` the output; must outlive the writer
+     */
+    explicit Writer(std::string& out) : out_(out) {}
+
+    Writer& begin_object();
+    Writer& end_object();
+    Writer& begin_array();
+    Writer& end_array();
+
+    /**
+     * @brief Start an object member; the next value written is its value
+     */
+    Writer& key(std::string_view key);
+
+    Writer& value(std::string_view value);
+    Writer& value(const char* value) {
+        return this->value(std::string_view(value));
+    }
+    // (preferred over the integral template for bools)
+    Writer& value(bool value);
+
+    /**
+     * @brief Write a number (non-finite doubles, which JSON can't represent,
+     * are written as null)
+     */
+    Writer& value(double value);
+    template <std::integral T>
+    Writer& value(T value) {
+        char buf[24];
+        auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+        separate();
+        out_.append(buf, end);
+        return *this;
+    }
+
+    Writer& null();
+
+    /**
+     * @brief Write already-serialized JSON as a value (not checked)
+     */
+    Writer& raw(std::string_view json);
+
+    /**
+     * @brief Write an object member: `key(key).value(value)`
+     */
+    template <typename T>
+    Writer& member(std::string_view key, const T& value) {
+        this->key(key);
+        return this->value(value);
+    }
+
+   private:
+    // comma before a value or key that follows another one
+    void separate() {
+        if (need_comma_) out_.push_back(',');
+        need_comma_ = true;
+    }
+    void write_string(std::string_view value);
+
+    std::string& out_;
+    bool need_comma_ = false;
+};
+
+}  // namespace brick::json
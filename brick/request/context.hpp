@@ -0,0 +1,84 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace brick {
+
+/**
+ * Per-request scratch space shared by middleware and handlers (e.g. an
+ * authenticated user set by an auth middleware, read by the handler).
+ *
+ * Each connection owns one Context for its whole lifetime; it is reset, not
+ * reallocated, between requests, and only the worker serving the connection
+ * touches it, so no locking is needed.
+ */
+class Context {
+   public:
+    /**
+     * @brief Reset for a new request, keeping allocated capacity
+     * @param `request_id` id of the new request
+     */
+    void reset(uint64_t request_id) {
+        request_id_ = request_id;
+        start_ = std::chrono::steady_clock::now();
+        size_ = 0;
+    }
+
+    /**
+     * @brief Get the server-unique id of the current request
+     * @return request id
+     */
+    uint64_t request_id() const { return request_id_; }
+
+    /**
+     * @brief Get the time the server started handling the request
+     * @return start time
+     */
+    std::chrono::steady_clock::time_point start_time() const { return start_; }
+
+    /**
+     * @brief Set a value (replaces any existing value for `key`)
+     * @param `key` the key
+     * @param `value` the value
+     */
+    void set(std::string_view key, std::string_view value) {
+        for (size_t i = 0; i < size_; i++) {
+            if (values_[i].first == key) {
+                values_[i].second = value;
+                return;
+            }
+        }
+        if (size_ == values_.size()) values_.emplace_back();
+        values_[size_].first = key;
+        values_[size_].second = value;
+        size_++;
+    }
+
+    /**
+     * @brief Get a value
+     * @param `key` the key
+     * @return the value, or nullptr if unset
+     */
+    const std::string* get(std::string_view key) const {
+        for (size_t i = 0; i < size_; i++) {
+            if (values_[i].first == key) return &values_[i].second;
+        }
+        return nullptr;
+    }
+
+   private:
+    uint64_t request_id_ = 0;
+    std::chrono::steady_clock::time_point start_;
+
+    // a handful of entries per request, so a linear scan beats hashing; slots
+    // past `size_` are kept around so their strings can be reused
+    std::vector<std::pair<std::string, std::string>> values_;
+    size_t size_ = 0;
+};
+
+}  // namespace brick
@@ -5,6 +5,7 @@
 #include <limits>
 #include <numeric>
 #include <string_view>
+#include <utility>
 
 namespace brick {
 
@@ -102,4 +103,13 @@ Request::Request(const std::string& request) : request_(request) {
     if (low < size_) body_ = request.substr(low, size_ - low);
 }
 
+Request::Request(std::string method, std::string route,
+                 std::string http_version,
+                 std::map<std::string, std::string> headers, std::string body)
+    : method_(std::move(method)),
+      route_(std::move(route)),
+      http_version_(std::move(http_version)),
+      body_(std::move(body)),
+      headers_(std::move(headers)) {}
+
 }  // namespace brick
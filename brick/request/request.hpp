@@ -3,6 +3,9 @@
 #include <map>
 #include <string>
 #include <string_view>
+#include <utility>
+
+#include "brick/request/context.hpp"
 
 namespace brick {
 class Request {
@@ -18,6 +21,17 @@ class Request {
      */
     explicit Request(const std::string& request);
 
+    /**
+     * @brief Constructor for an already-parsed Request (e.g. from HTTP/2)
+     * @param `method` the method
+     * @param `route` the route (request target)
+     * @param `http_version` the protocol version, e.g. "HTTP/2"
+     * @param `headers` the headers
+     * @param `body` the body
+     */
+    Request(std::string method, std::string route, std::string http_version,
+            std::map<std::string, std::string> headers, std::string body);
+
     // accessors
 
     /**
@@ -29,6 +43,15 @@ class Request {
         return headers_.at(header);
     }
 
+    /**
+     * @brief Check whether the request has a header
+     * @param `header` the header to look for
+     * @return true if present
+     */
+    bool has_header(const std::string& header) const {
+        return headers_.contains(header);
+    }
+
     /**
      * @brief Get all headers from the request
      * @return headers
@@ -53,6 +76,12 @@ class Request {
      */
     std::string body() const { return body_; }
 
+    /**
+     * @brief Get the body without copying it (e.g. for `json::Value::parse`)
+     * @return body, valid as long as the request
+     */
+    std::string_view body_view() const { return body_; }
+
     /**
      * @brief Get the raw request string
      * @return raw request string
@@ -65,16 +94,45 @@ class Request {
      */
     std::string route() const { return route_; }
 
+    /**
+     * @brief Get the per-request context shared with middleware
+     * @return context (nullptr if the request was not built by a Server)
+     */
+    Context* context() const { return context_; }
+
+    /**
+     * @brief Attach a per-request context
+     * @param `context` the context (owned by the connection)
+     */
+    void set_context(Context* context) { context_ = context; }
+
+    /**
+     * @brief Get the address of the client that sent the request
+     * @return IP address ("203.0.113.7", "2001:db8::1"), "unix" for Unix
+     * socket clients, or empty if the request was not built by a Server
+     */
+    const std::string& remote_address() const { return remote_address_; }
+
+    /**
+     * @brief Set the client address
+     * @param `address` the address, as returned by `remote_address`
+     */
+    void set_remote_address(std::string address) {
+        remote_address_ = std::move(address);
+    }
+
     ~Request() = default;
 
    private:
     std::string request_;
-    unsigned int size_;
+    unsigned int size_ = 0;
 
     std::string method_;
     std::string route_;
     std::string http_version_;
     std::string body_;
     std::map<std::string, std::string> headers_;
+    Context* context_ = nullptr;
+    std::string remote_address_;
 };
 }  // namespace brick
@@ -93,21 +93,39 @@ Response::Response(unsigned int status_code) : status_code_(status_code) {
     headers_["Content-Length"] = "0";
 }
 
-std::string Response::raw() {
+std::string Response::raw() { return head() + body_; }
+
+std::string Response::head() const {
     std::ostringstream oss;
+    // status codes we have no message for (e.g. relayed from a proxied
+    // upstream) go out with an empty reason phrase
+    auto message = kStatusMessages.find(status_code_);
     oss << "HTTP/1.1 " << status_code_ << " "
-        << kStatusMessages.at(status_code_) << "\r\n";
+        << (message != kStatusMessages.end() ? message->second : "")
+        << "\r\n";
     for (const auto& [key, value] : headers_) {
         oss << key << ": " << value << "\r\n";
     }
+    for (const auto& [key, value] : extra_headers_) {
+        oss << key << ": " << value << "\r\n";
+    }
+    if (length_from_body_) {
+        oss << "Content-Length: " << body_.size() << "\r\n";
+    }
     oss << "\r\n";
-    oss << body_;
     return oss.str();
 }
 
 void Response::set_body(const std::string& body) {
     body_ = body;
     headers_["Content-Length"] = std::to_string(body_.size());
+    length_from_body_ = false;
+}
+
+std::string& Response::mutable_body() {
+    headers_.erase("Content-Length");
+    length_from_body_ = true;
+    return body_;
 }
 
 // void Response::set_body(const std::string_view& body) {
@@ -119,7 +137,22 @@ void Response::set_body(const std::string& body) {
 // }
 
 void Response::set_header(const std::string& key, const std::string& value) {
+    remove_header(key);
     headers_[key] = value;
 }
 
+void Response::add_header(const std::string& key, const std::string& value) {
+    if (headers_.count(key) == 0) {
+        headers_[key] = value;
+    } else {
+        extra_headers_.emplace_back(key, value);
+    }
+}
+
+void Response::remove_header(const std::string& key) {
+    headers_.erase(key);
+    std::erase_if(extra_headers_,
+                  [&key](const auto& header) { return header.first == key; });
+}
+
 }  // namespace brick
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #include <map>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace brick {
 
@@ -19,6 +21,12 @@ class Response {
      */
     std::string raw();
 
+    /**
+     * @brief Build the status line and headers (everything but the body)
+     * @return response head, terminated by an empty line
+     */
+    std::string head() const;
+
     /**
      * @brief Set the body of the response
      * @param `body` the body of the response (as a string)
@@ -38,6 +46,21 @@ class Response {
      */
     void set_header(const std::string& key, const std::string& value);
 
+    /**
+     * @brief Add a header line, keeping the lines already set for `key`.
+     * For fields that can't be joined into one comma-separated value, like
+     * Set-Cookie (RFC 6265 section 3).
+     * @param `key` the key of the header
+     * @param `value` the value of the header
+     */
+    void add_header(const std::string& key, const std::string& value);
+
+    /**
+     * @brief Remove a header (every line of it) from the response
+     * @param `key` the key of the header
+     */
+    void remove_header(const std::string& key);
+
     // ** accessors **
 
     /**
@@ -52,6 +75,26 @@ class Response {
      */
     std::string body() const { return body_; }
 
+    /**
+     * @brief Get the size of the body without copying it
+     * @return body size in bytes
+     */
+    size_t body_size() const { return body_.size(); }
+
+    /**
+     * @brief Move the body out of the response, leaving it empty
+     * @return body
+     */
+    std::string release_body() { return std::move(body_); }
+
+    /**
+     * @brief Get the body for writing in place (e.g. by `json::Writer`).
+     * Content-Length is then left out of `headers()` and derived from the
+     * body by `head()`, until the next `set_body`.
+     * @return body
+     */
+    std::string& mutable_body();
+
     /**
      * @brief Get a header from the response
      * @param `key` the key of the header
@@ -61,6 +104,24 @@ class Response {
         return headers_.at(key);
     }
 
+    /**
+     * @brief Get all headers of the response
+     * @return headers
+     */
+    const std::map<std::string, std::string>& headers() const {
+        return headers_;
+    }
+
+    /**
+     * @brief Get the lines added by `add_header` for names that already had
+     * one in `headers()`, in the order they were added
+     * @return headers
+     */
+    const std::vector<std::pair<std::string, std::string>>& extra_headers()
+        const {
+        return extra_headers_;
+    }
+
     /**
      * Map of status codes to status message strings
      */
@@ -70,6 +131,10 @@ class Response {
     std::string body_;
     unsigned int status_code_;
     std::map<std::string, std::string> headers_;
+    // repeated lines, sent after the first one of their name
+    std::vector<std::pair<std::string, std::string>> extra_headers_;
+    // the body was written in place: Content-Length is computed by `head()`
+    bool length_from_body_ = false;
 };
 
 }  // namespace brick
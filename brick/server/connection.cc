@@ -0,0 +1,114 @@
+#include "connection.hpp"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <new>
+
+namespace brick {
+
+namespace {
+
+constexpr uint64_t pack(uint32_t tag, uint32_t index) {
+    return (static_cast<uint64_t>(tag) << 32) | index;
+}
+
+}  // namespace
+
+ConnectionTable::ConnectionTable(uint32_t capacity,
+                                 const std::vector<topology::Node>& nodes)
+    : capacity_(capacity),
+      partitions_(std::max<uint32_t>(nodes.size(), 1)),
+      partition_size_(std::max<uint32_t>(
+          (capacity + partitions_ - 1) / partitions_, 1)),
+      mapped_bytes_(std::max<size_t>(capacity * sizeof(Slot), 1)),
+      free_lists_(std::make_unique<FreeList[]>(partitions_)) {
+    void* base = mmap(nullptr, mapped_bytes_, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+    slots_ = static_cast<Slot*>(base);
+
+    for (uint32_t p = 0; p < partitions_; p++) {
+        if (nodes.empty()) {
+            init_partition(p);
+        } else {
+            topology::run_on(nodes[p], [this, p] { init_partition(p); });
+        }
+    }
+}
+
+ConnectionTable::~ConnectionTable() {
+    for (uint32_t i = 0; i < capacity_; i++) {
+        slots_[i].~Slot();
+    }
+    munmap(slots_, mapped_bytes_);
+}
+
+void ConnectionTable::init_partition(uint32_t partition) {
+    uint32_t begin = std::min(partition * partition_size_, capacity_);
+    uint32_t end = std::min(begin + partition_size_, capacity_);
+
+    // chain every slot into the free list, lowest index first
+    for (uint32_t i = begin; i < end; i++) {
+        new (&slots_[i]) Slot();
+        if (i + 1 < end) {
+            slots_[i].next_free.store(i + 1, std::memory_order_relaxed);
+        }
+    }
+    free_lists_[partition].head.store(pack(0, begin < end ? begin : kNoIndex));
+}
+
+bool ConnectionTable::pop(uint32_t partition, uint32_t* index) {
+    std::atomic<uint64_t>& free_head = free_lists_[partition].head;
+    uint64_t head = free_head.load(std::memory_order_acquire);
+    do {
+        *index = head & 0xFFFFFFFF;
+        if (*index == kNoIndex) return false;
+        uint32_t next =
+            slots_[*index].next_free.load(std::memory_order_relaxed);
+        // bump the tag so a concurrent pop/push of the same index can't ABA us
+        if (free_head.compare_exchange_weak(head, pack((head >> 32) + 1, next),
+                                            std::memory_order_acquire)) {
+            return true;
+        }
+    } while (true);
+}
+
+Connection* ConnectionTable::acquire(int fd, ConnectionHandle* handle,
+                                     uint32_t partition) {
+    uint32_t index;
+    uint32_t tried = 0;
+    while (!pop((partition + tried) % partitions_, &index)) {
+        if (++tried == partitions_) return nullptr;
+    }
+
+    Slot& slot = slots_[index];
+    slot.conn.fd = fd;
+    uint32_t generation = slot.generation.load(std::memory_order_relaxed);
+    *handle = pack(generation, index);
+    // handed out busy, to the caller
+    slot.conn.idle.store(pack(generation, kIdleBusy),
+                         std::memory_order_relaxed);
+    return &slot.conn;
+}
+
+void ConnectionTable::release(ConnectionHandle handle) {
+    uint32_t index = handle & 0xFFFFFFFF;
+    Slot& slot = slots_[index];
+
+    slot.conn.reset();
+    // invalidate outstanding handles before the slot can be handed out again
+    slot.generation.fetch_add(1, std::memory_order_release);
+
+    std::atomic<uint64_t>& free_head = free_lists_[partition(handle)].head;
+    uint64_t head = free_head.load(std::memory_order_relaxed);
+    do {
+        slot.next_free.store(head & 0xFFFFFFFF, std::memory_order_relaxed);
+    } while (!free_head.compare_exchange_weak(
+        head, pack((head >> 32) + 1, index), std::memory_order_release,
+        std::memory_order_relaxed));
+}
+
+}  // namespace brick
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <netinet/in.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "brick/http2/session.hpp"
+#include "brick/request/context.hpp"
+#include "brick/server/proxy.hpp"
+#include "brick/server/topology.hpp"
+#include "brick/tls/tls.hpp"
+
+namespace brick {
+
+/**
+ * Generation-tagged reference to a `ConnectionTable` slot, stored directly in
+ * `epoll_event.data.u64`. The low 32 bits are the slot index and the high 32
+ * bits the slot's generation, so an event for a connection that has since been
+ * closed (and whose slot was reused) is detected and dropped.
+ */
+using ConnectionHandle = uint64_t;
+
+// handle that never refers to a connection
+constexpr ConnectionHandle kNoConnection = ~0ULL;
+
+// `Connection::idle` states, in its low 32 bits; the high 32 bits hold the
+// generation of the handle the state was set through, so a stale handle
+// never matches it
+// a worker has the connection, or it waits on something other than its client
+constexpr uint32_t kIdleBusy = 0;
+// claimed by the idle sweep, which closes it
+constexpr uint32_t kIdleExpired = 1;
+// armed and waiting for its client until (state - kIdleUntil), in seconds of
+// the server's idle clock; or that plus kIdleBetween when it is between
+// requests (rather than partway through one or its TLS handshake)
+constexpr uint32_t kIdleUntil = 2;
+constexpr uint32_t kIdleBetween = 1U << 30;
+// being armed to wait for its client. The low bits count arms, so the worker
+// arming it can tell whether another worker has since taken it (and maybe
+// started arming it again).
+constexpr uint32_t kIdleArming = 1U << 31;
+
+/**
+ * @brief Per-connection state. Only the thread that received the (one-shot)
+ * epoll event for a connection touches it, so no locking is needed.
+ */
+struct alignas(64) Connection {
+    int fd = -1;
+    // client address, formatted once on accept (see `Request::remote_address`)
+    std::string remote_address;
+    // the same address in binary, for the access log: IPv4 clients as
+    // v4-mapped addresses, all zero for Unix socket clients
+    struct in6_addr remote_ip = {};
+
+    // bytes received but not yet parsed into a request
+    std::string in;
+    // rendered responses (head and body chunks) waiting for one `writev`, and
+    // how much of the first chunk has already been sent
+    std::vector<std::string> out;
+    size_t out_offset = 0;
+    // close once `out` is flushed (no keep-alive, or the peer hung up)
+    bool close_after = false;
+    // per-request state for middleware, reused across requests
+    Context context;
+    // set once the connection speaks HTTP/2
+    std::unique_ptr<http2::Session> h2;
+    // set for connections accepted on a TLS listener
+    std::unique_ptr<tls::Channel> tls;
+    // reverse proxying: the other end of an exchange in progress (a client's
+    // upstream connection, or an upstream connection's client)
+    ConnectionHandle peer = kNoConnection;
+    // set on upstream connections
+    ProxyExchange proxy;
+    // when the client must have sent its next request by (idle clock
+    // seconds); kept across the reads of a partial request
+    uint32_t waiting_until = 0;
+    uint32_t arms = 0;
+    // the idle state (`kIdle*`): the one field other threads touch. A worker
+    // only handles the connection once it has taken it from this, and the
+    // idle sweep only closes it once it has claimed it.
+    std::atomic<uint64_t> idle = 0;
+
+    /**
+     * @brief Clear state for reuse, keeping buffer capacity
+     */
+    void reset() {
+        fd = -1;
+        remote_address.clear();
+        remote_ip = {};
+        in.clear();
+        out.clear();
+        out_offset = 0;
+        close_after = false;
+        h2.reset();
+        tls.reset();
+        peer = kNoConnection;
+        proxy.reset();
+    }
+};
+
+/**
+ * @brief Fixed-capacity slab of connections with a lock-free free list.
+ *
+ * All slots are allocated up front; closing a connection returns its slot
+ * (and its buffers' capacity) to the free list instead of freeing it, and
+ * dispatching an event is a direct index into the slab.
+ *
+ * The slab can be split into one partition per NUMA node: each partition's
+ * slots are initialized on (so allocated from) its node and have their own
+ * free list, and a slot always returns to the partition it came from.
+ */
+class ConnectionTable {
+   public:
+    /**
+     * @brief Constructor for ConnectionTable
+     * @param `capacity` maximum number of simultaneously open connections
+     * @param `nodes` NUMA nodes to split the slots evenly between, in
+     * partition order; empty for a single partition in local memory
+     */
+    explicit ConnectionTable(uint32_t capacity,
+                             const std::vector<topology::Node>& nodes = {});
+    ~ConnectionTable();
+
+    ConnectionTable(const ConnectionTable&) = delete;
+    ConnectionTable& operator=(const ConnectionTable&) = delete;
+
+    /**
+     * @brief Take a free slot for `fd`
+     * @param `fd` the client socket
+     * @param `handle` set to the new connection's handle
+     * @param `partition` partition to take the slot from; when it is full,
+     * the others are tried in turn
+     * @return the connection, or nullptr if the table is full
+     */
+    Connection* acquire(int fd, ConnectionHandle* handle,
+                        uint32_t partition = 0);
+
+    /**
+     * @brief Look up a connection by handle
+     * @return the connection, or nullptr if the handle is stale
+     */
+    Connection* get(ConnectionHandle handle) {
+        uint32_t index = handle & 0xFFFFFFFF;
+        if (index >= capacity_) return nullptr;
+        Slot& slot = slots_[index];
+        return slot.generation.load(std::memory_order_acquire) == (handle >> 32)
+                   ? &slot.conn
+                   : nullptr;
+    }
+
+    /**
+     * @brief Get the connection in slot `index`, whether in use or not (for
+     * sweeps that go by `Connection::idle` rather than by handle)
+     */
+    Connection& slot(uint32_t index) { return slots_[index].conn; }
+
+    /**
+     * @brief Return a connection's slot to the free list (invalidates handles)
+     */
+    void release(ConnectionHandle handle);
+
+    /**
+     * @brief Get the partition a connection's slot belongs to
+     */
+    uint32_t partition(ConnectionHandle handle) const {
+        return (handle & 0xFFFFFFFF) / partition_size_;
+    }
+
+    uint32_t capacity() const { return capacity_; }
+
+    /**
+     * Slot index that no connection uses - handles built from it are free for
+     * other epoll registrants (listeners, ...)
+     */
+    static constexpr uint32_t kNoIndex = 0xFFFFFFFF;
+
+   private:
+    struct Slot {
+        Connection conn;
+        std::atomic<uint32_t> generation = 0;
+        std::atomic<uint32_t> next_free = kNoIndex;
+    };
+
+    // a partition's free list, on its own cache line
+    struct alignas(64) FreeList {
+        // (ABA tag << 32) | index of the first free slot
+        std::atomic<uint64_t> head;
+    };
+
+    void init_partition(uint32_t partition);
+    bool pop(uint32_t partition, uint32_t* index);
+
+    uint32_t capacity_;
+    uint32_t partitions_;
+    uint32_t partition_size_;
+    // mapped, not allocated, so no page is touched before its partition is
+    // initialized on the right node
+    Slot* slots_;
+    size_t mapped_bytes_;
+    std::unique_ptr<FreeList[]> free_lists_;
+};
+
+}  // namespace brick
@@ -0,0 +1,103 @@
+#include "brick/server/connection.hpp"
+
+#include <gtest/gtest.h>
+
+#include <set>
+#include <vector>
+
+#include "brick/server/topology.hpp"
+
+namespace brick {
+namespace {
+
+// `count` partitions, all on the node this process runs on
+std::vector<topology::Node> nodes(int count) {
+    topology::Node node = topology::detect().front();
+    return std::vector<topology::Node>(count, node);
+}
+
+TEST(ConnectionTableTest, ReusesReleasedSlots) {
+    ConnectionTable table(4);
+    ConnectionHandle handle;
+    Connection* conn = table.acquire(10, &handle);
+    ASSERT_NE(conn, nullptr);
+    EXPECT_EQ(conn->fd, 10);
+    EXPECT_EQ(table.get(handle), conn);
+
+    // the state is cleared, the slot (and its buffers) reused
+    conn->in = "partial request";
+    conn->close_after = true;
+    table.release(handle);
+    ConnectionHandle again;
+    Connection* reused = table.acquire(11, &again);
+    EXPECT_EQ(reused, conn);
+    EXPECT_EQ(reused->fd, 11);
+    EXPECT_TRUE(reused->in.empty());
+    EXPECT_FALSE(reused->close_after);
+    EXPECT_EQ(reused->peer, kNoConnection);
+    // same slot, new generation
+    EXPECT_EQ(again & 0xFFFFFFFF, handle & 0xFFFFFFFF);
+    EXPECT_NE(again, handle);
+}
+
+TEST(ConnectionTableTest, StaleHandleFindsNothing) {
+    ConnectionTable table(4);
+    ConnectionHandle handle;
+    ASSERT_NE(table.acquire(10, &handle), nullptr);
+    table.release(handle);
+    EXPECT_EQ(table.get(handle), nullptr);
+
+    // not even once the slot is in use again
+    ConnectionHandle again;
+    Connection* conn = table.acquire(11, &again);
+    ASSERT_NE(conn, nullptr);
+    EXPECT_EQ(table.get(handle), nullptr);
+    EXPECT_EQ(table.get(again), conn);
+
+    // nor for indices outside the table
+    EXPECT_EQ(table.get(kNoConnection), nullptr);
+    EXPECT_EQ(table.get(4), nullptr);
+}
+
+TEST(ConnectionTableTest, ReturnsNullWhenFull) {
+    ConnectionTable table(3);
+    std::set<Connection*> taken;
+    ConnectionHandle handles[3];
+    for (int i = 0; i < 3; i++) {
+        Connection* conn = table.acquire(i, &handles[i]);
+        ASSERT_NE(conn, nullptr);
+        taken.insert(conn);
+    }
+    EXPECT_EQ(taken.size(), 3);
+
+    ConnectionHandle handle;
+    EXPECT_EQ(table.acquire(3, &handle), nullptr);
+    // until a slot comes back
+    table.release(handles[1]);
+    EXPECT_NE(table.acquire(3, &handle), nullptr);
+    EXPECT_EQ(table.acquire(4, &handle), nullptr);
+}
+
+TEST(ConnectionTableTest, FallsBackToOtherPartitions) {
+    ConnectionTable table(4, nodes(2));
+    // two slots per partition
+    ConnectionHandle handles[4];
+    for (int i = 0; i < 4; i++) {
+        ASSERT_NE(table.acquire(i, &handles[i], 0), nullptr) << i;
+    }
+    EXPECT_EQ(table.partition(handles[0]), 0);
+    EXPECT_EQ(table.partition(handles[1]), 0);
+    // partition 0 is full: the rest come from partition 1
+    EXPECT_EQ(table.partition(handles[2]), 1);
+    EXPECT_EQ(table.partition(handles[3]), 1);
+    ConnectionHandle handle;
+    EXPECT_EQ(table.acquire(4, &handle, 1), nullptr);
+
+    // a slot returns to its own partition
+    table.release(handles[2]);
+    ASSERT_NE(table.acquire(5, &handle, 0), nullptr);
+    EXPECT_EQ(table.partition(handle), 1);
+}
+
+}  // namespace
+}  // namespace brick
@@ -0,0 +1,51 @@
+#include "framing.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+namespace brick {
+
+namespace {
+
+// whether a header line starts with `name` (lowercase, colon included)
+bool has_name(std::string_view line, std::string_view name) {
+    return line.size() >= name.size() &&
+           std::equal(name.begin(), name.end(), line.begin(),
+                      [](char a, char b) {
+                          return a == std::tolower(static_cast<uint8_t>(b));
+                      });
+}
+
+}  // namespace
+
+BodyFraming request_framing(std::string_view head, uint64_t max,
+                            uint64_t* length) {
+    static constexpr std::string_view kContentLength = "content-length:";
+    static constexpr std::string_view kTransferEncoding =
+        "transfer-encoding:";
+
+    std::optional<uint64_t> body_length;
+    for (size_t i = head.find("\r\n"); i != std::string_view::npos;
+         i = head.find("\r\n", i + 2)) {
+        size_t line_end = head.find("\r\n", i + 2);
+        std::string_view line = head.substr(
+            i + 2, line_end == std::string_view::npos ? line_end
+                                                      : line_end - i - 2);
+        if (has_name(line, kTransferEncoding)) {
+            return BodyFraming::kTransferEncoding;
+        }
+        if (!has_name(line, kContentLength)) continue;
+
+        std::optional<uint64_t> value =
+            parse_content_length(line.substr(kContentLength.size()), max);
+        if (!value || (body_length && *body_length != *value)) {
+            return BodyFraming::kInvalid;
+        }
+        body_length = value;
+    }
+
+    *length = body_length.value_or(0);
+    return BodyFraming::kLength;
+}
+
+}  // namespace brick
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+/**
+ * HTTP/1.1 message framing checks shared by the server and the reverse
+ * proxy. A body length that two parties could read differently lets one
+ * message hide inside another (request smuggling, or a desynced keep-alive
+ * connection), so anything but a plain, single length is refused.
+ */
+
+namespace brick {
+
+/**
+ * @brief Parse a Content-Length value (RFC 9110 8.6): digits only, optionally
+ * surrounded by spaces or tabs
+ * @param `max` largest acceptable length
+ * @return the length, or std::nullopt if malformed, out of range or above
+ * `max`
+ */
+inline std::optional<uint64_t> parse_content_length(std::string_view value,
+                                                    uint64_t max = UINT64_MAX) {
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+        value.remove_prefix(1);
+    }
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+        value.remove_suffix(1);
+    }
+    // from_chars alone would take a leading '-' or stop at a ','
+    if (value.empty() || value.find_first_not_of("0123456789") !=
+                             std::string_view::npos) {
+        return std::nullopt;
+    }
+
+    uint64_t length;
+    auto [end, ec] =
+        std::from_chars(value.data(), value.data() + value.size(), length);
+    if (ec != std::errc() || end != value.data() + value.size() ||
+        length > max) {
+        return std::nullopt;
+    }
+    return length;
+}
+
+enum class BodyFraming {
+    // Content-Length, or no body
+    kLength,
+    // Transfer-Encoding (not decoded: the body can't be delimited)
+    kTransferEncoding,
+    // malformed, too large, or conflicting Content-Length values
+    kInvalid,
+};
+
+/**
+ * @brief Find out how a request head delimits the body that follows
+ * @param `head` the request head (request line and header lines)
+ * @param `max` largest acceptable body length
+ * @param `length` set to the body length for `kLength` (0 if none)
+ */
+BodyFraming request_framing(std::string_view head, uint64_t max,
+                            uint64_t* length);
+
+}  // namespace brick
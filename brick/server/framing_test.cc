@@ -0,0 +1,64 @@
+#include "brick/server/framing.hpp"
+
+#include <gtest/gtest.h>
+
+namespace brick {
+namespace {
+
+TEST(ContentLengthTest, AcceptsDigits) {
+    EXPECT_EQ(parse_content_length("0"), 0);
+    EXPECT_EQ(parse_content_length("42"), 42);
+    EXPECT_EQ(parse_content_length(" \t42 "), 42);
+    EXPECT_EQ(parse_content_length("18446744073709551615"), UINT64_MAX);
+}
+
+TEST(ContentLengthTest, RejectsMalformed) {
+    EXPECT_EQ(parse_content_length(""), std::nullopt);
+    EXPECT_EQ(parse_content_length("  "), std::nullopt);
+    EXPECT_EQ(parse_content_length("-1"), std::nullopt);
+    EXPECT_EQ(parse_content_length("+1"), std::nullopt);
+    EXPECT_EQ(parse_content_length("0x10"), std::nullopt);
+    EXPECT_EQ(parse_content_length("1 2"), std::nullopt);
+    EXPECT_EQ(parse_content_length("42, 42"), std::nullopt);
+    EXPECT_EQ(parse_content_length("4e2"), std::nullopt);
+}
+
+TEST(ContentLengthTest, RejectsOutOfRange) {
+    EXPECT_EQ(parse_content_length("18446744073709551616"), std::nullopt);
+    EXPECT_EQ(parse_content_length("99999999999999999999999"), std::nullopt);
+    EXPECT_EQ(parse_content_length("1025", 1024), std::nullopt);
+    EXPECT_EQ(parse_content_length("1024", 1024), 1024);
+}
+
+TEST(RequestFramingTest, ReadsLength) {
+    uint64_t length = 1;
+    EXPECT_EQ(request_framing("GET / HTTP/1.1\r\nHost: a", 100, &length),
+              BodyFraming::kLength);
+    EXPECT_EQ(length, 0);
+    EXPECT_EQ(request_framing("POST / HTTP/1.1\r\ncontent-LENGTH: 12\r\n"
+                              "Content-Length:12",
+                              100, &length),
+              BodyFraming::kLength);
+    EXPECT_EQ(length, 12);
+}
+
+TEST(RequestFramingTest, RejectsAmbiguousBodies) {
+    uint64_t length;
+    EXPECT_EQ(request_framing("POST / HTTP/1.1\r\nContent-Length: 1\r\n"
+                              "Content-Length: 2",
+                              100, &length),
+              BodyFraming::kInvalid);
+    EXPECT_EQ(request_framing("POST / HTTP/1.1\r\nContent-Length: -1", 100,
+                              &length),
+              BodyFraming::kInvalid);
+    EXPECT_EQ(request_framing("POST / HTTP/1.1\r\nContent-Length: 101", 100,
+                              &length),
+              BodyFraming::kInvalid);
+    EXPECT_EQ(request_framing("POST / HTTP/1.1\r\nContent-Length: 3\r\n"
+                              "Transfer-Encoding: chunked",
+                              100, &length),
+              BodyFraming::kTransferEncoding);
+}
+
+}  // namespace
+}  // namespace brick
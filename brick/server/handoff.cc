@@ -0,0 +1,271 @@
+#include "handoff.hpp"
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#include "brick/utils/logging/logger.hpp"
+
+namespace brick::handoff {
+
+namespace {
+
+constexpr char kMagic[] = {'B', 'R', 'K', '2'};
+constexpr char kAck = 'A';
+constexpr size_t kMaxFds = 64;
+// magic + u32 length of the listener list
+constexpr size_t kHeaderSize = sizeof(kMagic) + 4;
+// per listener: kind, tls, port, address length
+constexpr size_t kListenerHeaderSize = 6;
+constexpr size_t kMaxListenersSize =
+    kMaxFds * (kListenerHeaderSize + UINT16_MAX);
+constexpr int kTimeoutSeconds = 5;
+
+bool fill_address(const std::string& path, struct sockaddr_un* addr) {
+    if (path.size() >= sizeof(addr->sun_path)) {
+        log::error("Handoff path too long: ", path);
+        return false;
+    }
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    memcpy(addr->sun_path, path.c_str(), path.size());
+    return true;
+}
+
+// the handshake is a couple of bytes, so a stuck peer should not wedge us
+void set_timeouts(int fd) {
+    struct timeval tv = {kTimeoutSeconds, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+void write_uint(uint32_t value, size_t bytes, std::string* out) {
+    for (size_t i = bytes; i-- > 0;) {
+        out->push_back(static_cast<char>(value >> (8 * i)));
+    }
+}
+
+// take a big-endian integer off the front of `in`
+bool read_uint(std::string_view* in, size_t bytes, uint32_t* value) {
+    if (in->size() < bytes) return false;
+    *value = 0;
+    for (size_t i = 0; i < bytes; i++) {
+        *value = (*value << 8) | static_cast<uint8_t>((*in)[i]);
+    }
+    in->remove_prefix(bytes);
+    return true;
+}
+
+std::string encode(const std::vector<Listener>& listeners) {
+    std::string out;
+    for (const Listener& listener : listeners) {
+        write_uint(static_cast<uint32_t>(listener.kind), 1, &out);
+        write_uint(listener.tls, 1, &out);
+        write_uint(listener.port, 2, &out);
+        write_uint(listener.address.size(), 2, &out);
+        out += listener.address;
+    }
+    return out;
+}
+
+bool decode(std::string_view in, std::vector<Listener>* listeners) {
+    while (!in.empty()) {
+        uint32_t kind, tls, port, length;
+        if (!read_uint(&in, 1, &kind) || !read_uint(&in, 1, &tls) ||
+            !read_uint(&in, 2, &port) || !read_uint(&in, 2, &length) ||
+            kind > static_cast<uint32_t>(Listener::Kind::kAbstract) ||
+            in.size() < length) {
+            return false;
+        }
+        Listener listener{static_cast<Listener::Kind>(kind),
+                          std::string(in.substr(0, length)),
+                          static_cast<int>(port), tls != 0};
+        listeners->push_back(std::move(listener));
+        in.remove_prefix(length);
+    }
+    return true;
+}
+
+bool same(const Listener& a, const Listener& b) {
+    return a.kind == b.kind && a.address == b.address && a.port == b.port &&
+           a.tls == b.tls;
+}
+
+std::string describe(const std::vector<Listener>& listeners) {
+    std::string text;
+    for (const Listener& listener : listeners) {
+        text += (text.empty() ? "" : ", ") + listener.describe();
+    }
+    return text.empty() ? "nothing" : text;
+}
+
+// order `inherited` like `listeners`; false unless they are the same set
+bool match(const std::vector<Listener>& listeners,
+           const std::vector<Listener>& inherited,
+           const std::vector<int>& inherited_fds, std::vector<int>* fds) {
+    if (inherited.size() != listeners.size()) return false;
+    std::vector<bool> taken(inherited.size());
+    for (const Listener& listener : listeners) {
+        size_t i = 0;
+        while (i < inherited.size() &&
+               (taken[i] || !same(inherited[i], listener))) {
+            i++;
+        }
+        if (i == inherited.size()) return false;
+        taken[i] = true;
+        fds->push_back(inherited_fds[i]);
+    }
+    return true;
+}
+
+}  // namespace
+
+bool receive_listeners(const std::string& path,
+                       const std::vector<Listener>& listeners,
+                       std::vector<int>* fds) {
+    struct sockaddr_un addr;
+    if (!fill_address(path, &addr)) return true;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return true;
+
+    // nobody is listening -> cold start
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) <
+        0) {
+        close(fd);
+        return true;
+    }
+    set_timeouts(fd);
+
+    char header[kHeaderSize];
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int) * kMaxFds)];
+    struct iovec iov = {header, sizeof(header)};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    std::vector<int> received;
+    ssize_t size = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC | MSG_WAITALL);
+    if (size > 0) {
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+             cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level != SOL_SOCKET ||
+                cmsg->cmsg_type != SCM_RIGHTS) {
+                continue;
+            }
+            size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            const auto* data = reinterpret_cast<const int*>(CMSG_DATA(cmsg));
+            received.insert(received.end(), data, data + count);
+        }
+    }
+
+    // then the listeners the fds belong to
+    std::vector<Listener> inherited;
+    std::string_view length_field(header + sizeof(kMagic), 4);
+    uint32_t length = 0;
+    bool valid = size == sizeof(header) &&
+                 memcmp(header, kMagic, sizeof(kMagic)) == 0 &&
+                 read_uint(&length_field, 4, &length) &&
+                 length <= kMaxListenersSize;
+    if (valid) {
+        std::string body(length, '\0');
+        valid = recv(fd, body.data(), length, MSG_WAITALL) ==
+                    static_cast<ssize_t>(length) &&
+                decode(body, &inherited) &&
+                inherited.size() == received.size();
+    }
+
+    bool matched = true;
+    if (!valid) {
+        log::warning("Malformed handoff from ", path);
+    } else if (!match(listeners, inherited, received, fds)) {
+        log::error("The server on ", path, " listens on ", describe(inherited),
+                   " but this one is configured for ", describe(listeners));
+        fds->clear();
+        matched = false;
+    }
+
+    // only ack once the fds are ours; otherwise the old process keeps serving
+    if (!fds->empty() && send(fd, &kAck, 1, MSG_NOSIGNAL) != 1) {
+        fds->clear();
+    }
+    if (fds->empty()) {
+        for (int inherited_fd : received) close(inherited_fd);
+    }
+
+    close(fd);
+    return matched;
+}
+
+int listen_for_successor(const std::string& path) {
+    struct sockaddr_un addr;
+    if (!fill_address(path, &addr)) return -1;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+
+    // the file may belong to the process we just took over from
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) <
+            0 ||
+        listen(fd, 1) < 0) {
+        log::error("Could not bind handoff socket ", path, ": ",
+                   strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+bool send_listeners(int handoff_fd, const std::vector<Listener>& listeners,
+                    const std::vector<int>& fds) {
+    if (fds.empty() || fds.size() > kMaxFds ||
+        listeners.size() != fds.size()) {
+        return false;
+    }
+
+    int fd = accept4(handoff_fd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) return false;
+    set_timeouts(fd);
+
+    std::string body = encode(listeners);
+    std::string message(kMagic, sizeof(kMagic));
+    write_uint(body.size(), 4, &message);
+    message += body;
+
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int) * kMaxFds)];
+    memset(control, 0, sizeof(control));
+    struct iovec iov = {message.data(), message.size()};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+    memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+
+    char ack = 0;
+    bool ok = sendmsg(fd, &msg, MSG_NOSIGNAL) ==
+                  static_cast<ssize_t>(message.size()) &&
+              recv(fd, &ack, 1, 0) == 1 && ack == kAck;
+
+    close(fd);
+    return ok;
+}
+
+}  // namespace brick::handoff
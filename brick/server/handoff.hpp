@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "brick/server/listener.hpp"
+
+/**
+ * Listening-socket handoff for hot restarts.
+ *
+ * A running server binds a Unix domain stream socket at a well-known path.
+ * When an upgraded binary starts with the same path, it connects to the old
+ * process, which passes its listening sockets over using SCM_RIGHTS. The new
+ * process acknowledges, takes over the accepts, and rebinds the handoff path
+ * for the next upgrade. The listening sockets are never closed, so the kernel
+ * keeps queueing connections throughout the deploy.
+ *
+ * Each fd travels with the listener it was opened for, and the new process
+ * only takes over if those are exactly the listeners it is configured with.
+ * Otherwise it doesn't ack, and the old process keeps serving.
+ *
+ * Protocol (old -> new):  "BRK2" + u32 length + listeners, fds as ancillary
+ *                         data; a listener is u8 kind, u8 tls, u16 port,
+ *                         u16 address length + address (big-endian)
+ *          (new -> old):  one ack byte, sent once the fds are owned
+ */
+
+namespace brick::handoff {
+
+/**
+ * @brief Connect to a running server and take over its listening sockets
+ * @param `path` the handoff socket path
+ * @param `listeners` the listeners this process is configured with
+ * @param `fds` set to the inherited fds in the order of `listeners` (left
+ * empty if nothing is serving on `path`)
+ * @return false if the running server listens on anything other than
+ * `listeners`; it keeps its sockets then
+ */
+bool receive_listeners(const std::string& path,
+                       const std::vector<Listener>& listeners,
+                       std::vector<int>* fds);
+
+/**
+ * @brief Bind the handoff socket that a successor process will connect to
+ * @param `path` the handoff socket path (replaces any existing socket file)
+ * @return non-blocking listening fd, or -1 on failure
+ */
+int listen_for_successor(const std::string& path);
+
+/**
+ * @brief Accept a successor on `handoff_fd` and pass it `fds`
+ * @param `handoff_fd` the fd returned by `listen_for_successor`
+ * @param `listeners` what each of `fds` listens on
+ * @param `fds` the listening sockets to hand over
+ * @return true once the successor has acknowledged ownership of `fds`
+ */
+bool send_listeners(int handoff_fd, const std::vector<Listener>& listeners,
+                    const std::vector<int>& fds);
+
+}  // namespace brick::handoff
@@ -0,0 +1,106 @@
+#include "brick/server/handoff.hpp"
+
+#include <gtest/gtest.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace brick {
+namespace {
+
+ino_t inode(int fd) {
+    struct stat st;
+    EXPECT_EQ(fstat(fd, &st), 0);
+    return st.st_ino;
+}
+
+class HandoffTest : public ::testing::Test {
+   protected:
+    HandoffTest()
+        : path_("/tmp/brick_handoff_test." + std::to_string(getpid())) {
+        handoff_fd_ = handoff::listen_for_successor(path_);
+        for (int i = 0; i < 2; i++) {
+            fds_.push_back(socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0));
+        }
+    }
+
+    ~HandoffTest() override {
+        close(handoff_fd_);
+        unlink(path_.c_str());
+        for (int fd : fds_) close(fd);
+    }
+
+    // hand `fds_` (opened for `sent`) to a successor configured with
+    // `configured`; returns whether the successor acked
+    bool hand_off(const std::vector<Listener>& sent,
+                  const std::vector<Listener>& configured, bool* matched,
+                  std::vector<int>* received) {
+        std::thread successor([&] {
+            *matched = handoff::receive_listeners(path_, configured, received);
+        });
+        struct pollfd pfd = {handoff_fd_, POLLIN, 0};
+        EXPECT_EQ(poll(&pfd, 1, 5000), 1);
+        bool acked = handoff::send_listeners(handoff_fd_, sent, fds_);
+        successor.join();
+        return acked;
+    }
+
+    std::string path_;
+    int handoff_fd_;
+    std::vector<int> fds_;
+};
+
+const Listener kHttp{Listener::Kind::kTcp, "", 8080};
+const Listener kHttps{Listener::Kind::kTcp, "", 8443, true};
+
+TEST_F(HandoffTest, ReordersToConfiguredListeners) {
+    ASSERT_GE(handoff_fd_, 0);
+    bool matched = false;
+    std::vector<int> received;
+    EXPECT_TRUE(hand_off({kHttp, kHttps}, {kHttps, kHttp}, &matched,
+                         &received));
+
+    EXPECT_TRUE(matched);
+    ASSERT_EQ(received.size(), 2);
+    EXPECT_EQ(inode(received[0]), inode(fds_[1]));
+    EXPECT_EQ(inode(received[1]), inode(fds_[0]));
+    for (int fd : received) close(fd);
+}
+
+TEST_F(HandoffTest, RefusesDifferentListeners) {
+    ASSERT_GE(handoff_fd_, 0);
+    Listener plain = kHttps;
+    plain.tls = false;
+    bool matched = true;
+    std::vector<int> received;
+    EXPECT_FALSE(hand_off({kHttp, kHttps}, {kHttp, plain}, &matched,
+                          &received));
+
+    EXPECT_FALSE(matched);
+    EXPECT_TRUE(received.empty());
+}
+
+TEST_F(HandoffTest, RefusesMissingListeners) {
+    ASSERT_GE(handoff_fd_, 0);
+    bool matched = true;
+    std::vector<int> received;
+    EXPECT_FALSE(hand_off({kHttp, kHttps}, {kHttp}, &matched, &received));
+
+    EXPECT_FALSE(matched);
+    EXPECT_TRUE(received.empty());
+}
+
+TEST(HandoffColdStartTest, NothingToInherit) {
+    std::vector<int> received;
+    EXPECT_TRUE(handoff::receive_listeners("/tmp/brick_handoff_test.none",
+                                           {kHttp}, &received));
+    EXPECT_TRUE(received.empty());
+}
+
+}  // namespace
+}  // namespace brick
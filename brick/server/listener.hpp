@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+
+namespace brick {
+
+/**
+ * @brief An address for the server to accept connections on. All listeners
+ * feed the same event loop and router.
+ */
+struct Listener {
+    enum class Kind {
+        // TCP; `address` is the host to bind (empty for all IPv4 interfaces,
+        // "::" for dual-stack IPv4 + IPv6)
+        kTcp,
+        // Unix domain stream socket; `address` is the filesystem path
+        kUnix,
+        // Linux abstract-namespace Unix socket; `address` is the name
+        // (without the leading NUL)
+        kAbstract,
+    };
+
+    Kind kind;
+    std::string address;
+    int port = 0;
+    // terminate TLS on accepted connections (see `Server::enable_tls`)
+    bool tls = false;
+
+    /**
+     * @brief Human-readable address, for logging
+     */
+    std::string describe() const {
+        std::string text = address;
+        switch (kind) {
+            case Kind::kTcp:
+                text = (address.empty() ? "*" : "[" + address + "]") + ":" +
+                       std::to_string(port);
+                break;
+            case Kind::kUnix:
+                text = "unix:" + address;
+                break;
+            case Kind::kAbstract:
+                text = "unix:@" + address;
+                break;
+        }
+        return tls ? text + " (TLS)" : text;
+    }
+};
+
+}  // namespace brick
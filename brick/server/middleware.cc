@@ -0,0 +1,37 @@
+#include "middleware.hpp"
+
+namespace brick {
+
+Pipeline::Pipeline(std::vector<Middleware> chain) {
+    for (Middleware& middleware : chain) {
+        if (middleware.after) {
+            afters_.push_back(std::move(middleware.after));
+        }
+        if (middleware.before) {
+            befores_.emplace_back(std::move(middleware.before), afters_.size());
+        }
+    }
+}
+
+std::optional<Response> Pipeline::run_befores(const Request& request,
+                                              Context& context,
+                                              size_t* afters) const {
+    for (const auto& [before, depth] : befores_) {
+        std::optional<Response> response = before(request, context);
+        if (response) {
+            *afters = depth;  // unwind only the middleware that ran
+            return response;
+        }
+    }
+    *afters = afters_.size();
+    return std::nullopt;
+}
+
+void Pipeline::run_afters(const Request& request, Context& context,
+                          Response& response, size_t afters) const {
+    for (size_t i = afters; i-- > 0;) {
+        afters_[i](request, context, response);
+    }
+}
+
+}  // namespace brick
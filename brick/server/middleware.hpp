@@ -0,0 +1,71 @@
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "brick/request/context.hpp"
+#include "brick/request/request.hpp"
+#include "brick/response/response.hpp"
+
+namespace brick {
+
+/**
+ * Cross-cutting logic (auth, request ids, timing, rate limiting, ...) that
+ * runs around every handler.
+ *
+ * Middleware registered with `Server::use` is flattened into one vector when
+ * the server starts, so each request pays a single indirect call per hook -
+ * handlers are never wrapped in layers of `std::function`.
+ *
+ * For a chain A, B: A.before, B.before, handler, B.after, A.after. If a
+ * `before` returns a response, the remaining `before`s and the handler are
+ * skipped and only the `after`s of middleware that already ran are called.
+ */
+struct Middleware {
+    /**
+     * Runs before the handler; return a response to short-circuit the request
+     * (e.g. a pre-built 401), or `std::nullopt` to continue. Optional.
+     */
+    std::function<std::optional<Response>(const Request&, Context&)> before;
+
+    /**
+     * Runs after the handler, in reverse registration order; may modify the
+     * response. Optional.
+     */
+    std::function<void(const Request&, Context&, Response&)> after;
+};
+
+/**
+ * A middleware chain flattened into one vector per hook, as the server runs
+ * it: each `before` remembers how many `after`s belong to middleware
+ * registered up to and including it.
+ */
+class Pipeline {
+   public:
+    Pipeline() = default;
+    explicit Pipeline(std::vector<Middleware> chain);
+
+    /**
+     * @brief Run the `before`s in registration order until one answers
+     * @param `afters` set to the number of `after`s to unwind: all of them,
+     * or only those of the middleware that ran
+     * @return the short-circuiting response, or `std::nullopt`
+     */
+    std::optional<Response> run_befores(const Request& request,
+                                        Context& context,
+                                        size_t* afters) const;
+
+    /**
+     * @brief Run the first `afters` `after`s in reverse registration order
+     */
+    void run_afters(const Request& request, Context& context,
+                    Response& response, size_t afters) const;
+
+   private:
+    std::vector<std::pair<decltype(Middleware::before), size_t>> befores_;
+    std::vector<decltype(Middleware::after)> afters_;
+};
+
+}  // namespace brick
@@ -0,0 +1,86 @@
+#include "brick/server/middleware.hpp"
+
+#include <gtest/gtest.h>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace brick {
+namespace {
+
+// middleware `name` that logs its hooks to `calls`, and answers in `before`
+// when `answer` is set
+Middleware traced(const std::string& name, std::vector<std::string>* calls,
+                  bool answer = false) {
+    return {
+        [=](const Request&, Context&) -> std::optional<Response> {
+            calls->push_back(name + ".before");
+            if (answer) return Response(401);
+            return std::nullopt;
+        },
+        [=](const Request&, Context&, Response&) {
+            calls->push_back(name + ".after");
+        }};
+}
+
+// a request through `pipeline`, with the handler logging to `calls`
+Response run(const Pipeline& pipeline, std::vector<std::string>* calls) {
+    Request request("GET / HTTP/1.1\r\nHost: x\r\n\r\n");
+    Context context;
+    size_t afters;
+    std::optional<Response> response =
+        pipeline.run_befores(request, context, &afters);
+    if (!response) {
+        calls->push_back("handler");
+        response = Response(200);
+    }
+    pipeline.run_afters(request, context, *response, afters);
+    return std::move(*response);
+}
+
+TEST(PipelineTest, WrapsHandlerInRegistrationOrder) {
+    std::vector<std::string> calls;
+    Pipeline pipeline({traced("a", &calls), traced("b", &calls)});
+    EXPECT_EQ(run(pipeline, &calls).status_code(), 200);
+    EXPECT_EQ(calls, (std::vector<std::string>{"a.before", "b.before",
+                                               "handler", "b.after",
+                                               "a.after"}));
+}
+
+TEST(PipelineTest, ShortCircuitUnwindsOnlyWhatRan) {
+    std::vector<std::string> calls;
+    Pipeline pipeline({traced("a", &calls), traced("b", &calls, true),
+                       traced("c", &calls)});
+    EXPECT_EQ(run(pipeline, &calls).status_code(), 401);
+    // c and the handler are skipped; b's own `after` still runs
+    EXPECT_EQ(calls, (std::vector<std::string>{"a.before", "b.before",
+                                               "b.after", "a.after"}));
+}
+
+TEST(PipelineTest, SkipsMissingHooks) {
+    std::vector<std::string> calls;
+    Middleware before_only = traced("a", &calls, true);
+    before_only.after = nullptr;
+    Middleware after_only = traced("b", &calls);
+    after_only.before = nullptr;
+    Pipeline pipeline({after_only, before_only, traced("c", &calls)});
+    EXPECT_EQ(run(pipeline, &calls).status_code(), 401);
+    EXPECT_EQ(calls, (std::vector<std::string>{"a.before", "b.after"}));
+}
+
+TEST(PipelineTest, AftersMayChangeTheResponse) {
+    std::vector<std::string> calls;
+    Pipeline pipeline(
+        {{nullptr,
+          [](const Request&, Context&, Response& response) {
+              response.set_header("X-Outer", response.header("X-Inner"));
+          }},
+         {nullptr, [](const Request&, Context&, Response& response) {
+              response.set_header("X-Inner", "1");
+          }}});
+    EXPECT_EQ(run(pipeline, &calls).header("X-Outer"), "1");
+}
+
+}  // namespace
+}  // namespace brick
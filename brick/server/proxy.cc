@@ -0,0 +1,490 @@
+#include "proxy.hpp"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+
+#include "brick/server/framing.hpp"
+#include "brick/utils/logging/logger.hpp"
+
+namespace brick {
+
+namespace {
+
+// idle upstream connections of the calling worker, by upstream
+struct IdlePool {
+    std::unordered_map<const Upstream*, std::vector<int>> fds;
+
+    ~IdlePool() {
+        for (auto& [upstream, idle] : fds) {
+            for (int fd : idle) close(fd);
+        }
+    }
+};
+thread_local IdlePool idle_pool;
+
+// chunk sizes above this are treated as malformed
+constexpr uint64_t kMaxChunkSize = uint64_t{1} << 40;
+// and so are chunk size and trailer lines longer than this
+constexpr size_t kMaxLineLength = 8192;
+
+int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+bool iequals(std::string_view a, std::string_view b) {
+    return a.size() == b.size() &&
+           std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+               return std::tolower(static_cast<uint8_t>(x)) ==
+                      std::tolower(static_cast<uint8_t>(y));
+           });
+}
+
+bool icontains(std::string_view haystack, std::string_view needle) {
+    for (size_t i = 0; i + needle.size() <= haystack.size(); i++) {
+        if (iequals(haystack.substr(i, needle.size()), needle)) return true;
+    }
+    return false;
+}
+
+// headers that describe one hop, not the message (RFC 9110 section 7.6.1)
+bool hop_by_hop(std::string_view name) {
+    return iequals(name, "connection") || iequals(name, "keep-alive") ||
+           iequals(name, "proxy-connection") || iequals(name, "te") ||
+           iequals(name, "upgrade");
+}
+
+std::string_view trim(std::string_view value) {
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+        value.remove_prefix(1);
+    }
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+        value.remove_suffix(1);
+    }
+    return value;
+}
+
+int hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+}  // namespace
+
+// ** BodyReader **
+
+void BodyReader::start(Framing framing, uint64_t length) {
+    framing_ = framing;
+    state_ = framing == Framing::kChunked ? State::kSize : State::kData;
+    remaining_ = length;
+    chunk_size_ = 0;
+    in_extension_ = false;
+    line_length_ = 0;
+    cr_ = false;
+    failed_ = false;
+    done_ = framing == Framing::kNone ||
+            (framing == Framing::kLength && length == 0);
+}
+
+size_t BodyReader::consume(std::string_view in) {
+    if (framing_ == Framing::kUntilClose) return in.size();
+
+    size_t i = 0;
+    while (i < in.size() && !done_) {
+        switch (state_) {
+            case State::kData: {
+                uint64_t take = std::min<uint64_t>(remaining_, in.size() - i);
+                i += take;
+                remaining_ -= take;
+                if (remaining_ == 0) {
+                    if (framing_ == Framing::kLength) {
+                        done_ = true;
+                    } else {
+                        state_ = State::kDataEnd;
+                    }
+                }
+                break;
+            }
+
+            case State::kSize: {
+                // hex digits, then optionally whitespace and `;ext=...`,
+                // then CRLF
+                char c = in[i++];
+                if (cr_ || c == '\n') {
+                    if (c != '\n' || !cr_) {
+                        failed_ = done_ = true;
+                        break;
+                    }
+                    state_ = chunk_size_ == 0 ? State::kTrailer : State::kData;
+                    remaining_ = chunk_size_;
+                    chunk_size_ = 0;
+                    in_extension_ = false;
+                    line_length_ = 0;
+                    cr_ = false;
+                    break;
+                }
+
+                bool digit = !in_extension_ && hex_digit(c) >= 0;
+                // a size with no digits, or bytes that can't follow it
+                if ((!digit && line_length_ == 0) ||
+                    (!digit && !in_extension_ && c != ';' && c != ' ' &&
+                     c != '\t' && c != '\r') ||
+                    ++line_length_ > kMaxLineLength) {
+                    failed_ = done_ = true;
+                } else if (digit) {
+                    chunk_size_ = chunk_size_ * 16 + hex_digit(c);
+                    if (chunk_size_ > kMaxChunkSize) {
+                        failed_ = done_ = true;
+                    }
+                } else if (c == '\r') {
+                    cr_ = true;
+                } else {
+                    in_extension_ = true;
+                }
+                break;
+            }
+
+            case State::kDataEnd: {
+                // exactly CRLF after the chunk data
+                char c = in[i++];
+                if (c != (cr_ ? '\n' : '\r')) {
+                    failed_ = done_ = true;
+                } else if (cr_) {
+                    state_ = State::kSize;
+                    cr_ = false;
+                } else {
+                    cr_ = true;
+                }
+                break;
+            }
+
+            case State::kTrailer: {
+                // trailer fields, up to an empty line
+                char c = in[i++];
+                if (c == '\n') {
+                    if (line_length_ == 0) done_ = true;
+                    line_length_ = 0;
+                } else if (c != '\r' && ++line_length_ > kMaxLineLength) {
+                    failed_ = done_ = true;
+                }
+                break;
+            }
+        }
+    }
+    return i;
+}
+
+// ** Proxy **
+
+Proxy::Proxy(ProxyOptions options) : options_(options) {}
+
+void Proxy::add_tcp(const std::string& host, int port) {
+    add({Listener::Kind::kTcp, host, port});
+}
+
+void Proxy::add_unix(const std::string& path) {
+    add({Listener::Kind::kUnix, path});
+}
+
+void Proxy::add_abstract(const std::string& name) {
+    add({Listener::Kind::kAbstract, name});
+}
+
+void Proxy::add(Listener address) {
+    auto upstream = std::make_unique<Upstream>();
+    upstream->address = std::move(address);
+    upstreams_.push_back(std::move(upstream));
+}
+
+bool Proxy::resolve() {
+    if (upstreams_.empty()) {
+        log::fatal("Proxy has no upstreams");
+        return false;
+    }
+
+    for (auto& upstream : upstreams_) {
+        const Listener& address = upstream->address;
+        if (address.kind == Listener::Kind::kTcp) {
+            struct addrinfo hints, *res;  // NOLINT
+            memset(&hints, 0, sizeof(hints));
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+
+            int status = getaddrinfo(address.address.c_str(),
+                                     std::to_string(address.port).c_str(),
+                                     &hints, &res);
+            if (status != 0) {
+                log::fatal("Could not resolve upstream ", address.describe(),
+                           ": ", gai_strerror(status));
+                return false;
+            }
+            memcpy(&upstream->addr, res->ai_addr, res->ai_addrlen);
+            upstream->addr_len = res->ai_addrlen;
+            freeaddrinfo(res);
+            continue;
+        }
+
+        struct sockaddr_un* addr =
+            reinterpret_cast<struct sockaddr_un*>(&upstream->addr);
+        addr->sun_family = AF_UNIX;
+
+        // abstract names start with a NUL byte and are not NUL-terminated
+        size_t offset = address.kind == Listener::Kind::kAbstract ? 1 : 0;
+        if (address.address.size() + offset >= sizeof(addr->sun_path)) {
+            log::fatal("Unix socket address too long: ", address.address);
+            return false;
+        }
+        memcpy(addr->sun_path + offset, address.address.data(),
+               address.address.size());
+        upstream->addr_len = offsetof(struct sockaddr_un, sun_path) + offset +
+                             address.address.size() + (offset == 0 ? 1 : 0);
+    }
+    return true;
+}
+
+Upstream* Proxy::select() {
+    int64_t now = now_ns();
+    size_t count = upstreams_.size();
+    size_t first = next_.fetch_add(1, std::memory_order_relaxed) % count;
+
+    Upstream* best = nullptr;
+    int best_outstanding = 0;
+    for (size_t i = 0; i < count; i++) {
+        Upstream* upstream = upstreams_[(first + i) % count].get();
+        if (upstream->ejected_until.load(std::memory_order_relaxed) > now) {
+            continue;
+        }
+        int outstanding = upstream->outstanding.load(std::memory_order_relaxed);
+        if (best == nullptr || outstanding < best_outstanding) {
+            best = upstream;
+            best_outstanding = outstanding;
+        }
+    }
+
+    // everything is ejected: failing open beats refusing every request
+    return best != nullptr ? best : upstreams_[first].get();
+}
+
+int Proxy::take_idle(Upstream* upstream) {
+    std::vector<int>& idle = idle_pool.fds[upstream];
+    while (!idle.empty()) {
+        int fd = idle.back();
+        idle.pop_back();
+
+        // an idle connection must have nothing to read; EOF or stray bytes
+        // mean the upstream closed it (or is confused)
+        char c;
+        if (recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) < 0 &&
+            (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return fd;
+        }
+        close(fd);
+    }
+    return -1;
+}
+
+void Proxy::put_idle(Upstream* upstream, int fd) {
+    std::vector<int>& idle = idle_pool.fds[upstream];
+    if (idle.size() >= options_.max_idle_per_worker) {
+        close(fd);
+        return;
+    }
+    idle.push_back(fd);
+}
+
+int Proxy::connect(Upstream* upstream, bool* in_progress) {
+    int family = upstream->addr.ss_family;
+    int fd = socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (family != AF_UNIX) {
+        // requests and response heads are small writes on the critical path
+        int opt = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+    }
+
+    *in_progress = false;
+    if (::connect(fd, reinterpret_cast<struct sockaddr*>(&upstream->addr),
+                  upstream->addr_len) < 0) {
+        if (errno != EINPROGRESS) {
+            close(fd);
+            return -1;
+        }
+        *in_progress = true;
+    }
+    return fd;
+}
+
+void Proxy::report(Upstream* upstream, bool ok) {
+    if (ok) {
+        if (upstream->failures.load(std::memory_order_relaxed) != 0) {
+            upstream->failures.store(0, std::memory_order_relaxed);
+        }
+        return;
+    }
+
+    if (upstream->failures.fetch_add(1, std::memory_order_relaxed) + 1 ==
+        options_.max_failures) {
+        upstream->failures.store(0, std::memory_order_relaxed);
+        upstream->ejected_until.store(
+            now_ns() + std::chrono::nanoseconds(options_.ejection_time).count(),
+            std::memory_order_relaxed);
+        log::warning("Ejecting upstream ", upstream->address.describe(),
+                     " for ", options_.ejection_time.count(), "ms");
+    }
+}
+
+std::string Proxy::render_request(const Request& request, bool secure) {
+    std::string head;
+    head.reserve(512);
+    head.append(request.method())
+        .append(" ")
+        .append(request.route())
+        .append(" HTTP/1.1\r\n");
+
+    std::string forwarded_for;
+    for (const auto& [name, value] : request.headers()) {
+        // `Expect: 100-continue` is answered by the server itself
+        if (hop_by_hop(name) || iequals(name, "expect") ||
+            iequals(name, "x-forwarded-proto")) {
+            continue;
+        }
+        // the client is appended to the chain of earlier proxies
+        if (iequals(name, "x-forwarded-for")) {
+            forwarded_for = value;
+            continue;
+        }
+        head.append(name).append(": ").append(value).append("\r\n");
+    }
+
+    if (!request.remote_address().empty()) {
+        if (!forwarded_for.empty()) forwarded_for.append(", ");
+        forwarded_for.append(request.remote_address());
+    }
+    if (!forwarded_for.empty()) {
+        head.append("X-Forwarded-For: ").append(forwarded_for).append("\r\n");
+    }
+
+    head.append("X-Forwarded-Proto: ")
+        .append(secure ? "https" : "http")
+        .append("\r\n\r\n");
+    return head;
+}
+
+std::optional<Response> Proxy::parse_response(std::string_view head,
+                                              std::string_view method,
+                                              BodyReader* body,
+                                              bool* keep_alive) {
+    // HTTP/1.x SP status SP reason
+    if (head.size() < 12 || !head.starts_with("HTTP/1.") || head[8] != ' ' ||
+        !isdigit(head[9]) || !isdigit(head[10]) || !isdigit(head[11])) {
+        return std::nullopt;
+    }
+    bool http11 = head[7] == '1';
+    unsigned int status =
+        (head[9] - '0') * 100 + (head[10] - '0') * 10 + (head[11] - '0');
+    // protocol upgrades can't be relayed
+    if (status < 100 || status == 101) {
+        return std::nullopt;
+    }
+
+    Response response(status);
+    response.remove_header("Content-Type");
+    response.remove_header("Content-Length");
+
+    bool close = !http11;
+    bool chunked = false;
+    bool has_encoding = false;
+    bool has_length = false;
+    uint64_t length = 0;
+
+    size_t line_start = head.find("\r\n") + 2;
+    while (line_start < head.size()) {
+        size_t line_end = head.find("\r\n", line_start);
+        if (line_end == std::string_view::npos || line_end == line_start) {
+            break;
+        }
+        std::string_view line = head.substr(line_start, line_end - line_start);
+        line_start = line_end + 2;
+
+        size_t colon = line.find(':');
+        if (colon == std::string_view::npos) {
+            return std::nullopt;
+        }
+        std::string_view name = line.substr(0, colon);
+        std::string_view value = trim(line.substr(colon + 1));
+
+        if (iequals(name, "connection")) {
+            if (icontains(value, "close")) close = true;
+            if (icontains(value, "keep-alive")) close = false;
+            continue;
+        }
+        if (hop_by_hop(name)) {
+            continue;
+        }
+        if (iequals(name, "transfer-encoding")) {
+            has_encoding = true;
+            chunked = icontains(value, "chunked");
+        } else if (iequals(name, "content-length")) {
+            // a length we might read differently from the next hop (or from
+            // a repeat of the header) would desync the pooled connection
+            std::optional<uint64_t> value_length = parse_content_length(value);
+            if (!value_length || (has_length && *value_length != length)) {
+                return std::nullopt;
+            }
+            if (has_length) continue;  // an identical repeat
+            has_length = true;
+            length = *value_length;
+        }
+
+        // repeated fields are joined into one value, except Set-Cookie,
+        // whose values may contain commas (RFC 6265 section 3)
+        std::string key(name);
+        if (iequals(name, "set-cookie")) {
+            response.add_header(key, std::string(value));
+            continue;
+        }
+        auto existing = response.headers().find(key);
+        if (existing != response.headers().end()) {
+            response.set_header(key, existing->second + ", " +
+                                         std::string(value));
+        } else {
+            response.set_header(key, std::string(value));
+        }
+    }
+
+    // both is how responses get smuggled (RFC 9112 6.3)
+    if (has_encoding && has_length) {
+        return std::nullopt;
+    }
+
+    if (method == "HEAD" || status < 200 || status == 204 || status == 304) {
+        body->start(BodyReader::Framing::kNone);
+    } else if (chunked) {
+        body->start(BodyReader::Framing::kChunked);
+    } else if (has_length) {
+        body->start(BodyReader::Framing::kLength, length);
+    } else {
+        body->start(BodyReader::Framing::kUntilClose);
+        close = true;
+    }
+    *keep_alive = !close;
+    return response;
+}
+
+}  // namespace brick
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <sys/socket.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "brick/request/request.hpp"
+#include "brick/response/response.hpp"
+#include "brick/server/listener.hpp"
+
+namespace brick {
+
+/**
+ * @brief A backend behind a `Proxy`, with its balancing and health state
+ * (shared by all workers)
+ */
+struct Upstream {
+    // where to connect; same address kinds as listeners
+    Listener address;
+    // resolved when the server starts
+    sockaddr_storage addr = {};
+    socklen_t addr_len = 0;
+
+    // requests in flight, for least-outstanding balancing
+    std::atomic<int> outstanding = 0;
+    // consecutive failures, and until when (steady clock, ns) an ejected
+    // upstream is skipped
+    std::atomic<int> failures = 0;
+    std::atomic<int64_t> ejected_until = 0;
+};
+
+struct ProxyOptions {
+    // consecutive connect/IO failures before an upstream is ejected
+    int max_failures = 3;
+    // how long an ejected upstream is skipped before it is tried again
+    std::chrono::milliseconds ejection_time{10000};
+    // idle keep-alive connections kept per upstream, per worker thread
+    size_t max_idle_per_worker = 16;
+};
+
+/**
+ * @brief Finds where an HTTP/1.1 message body ends as its bytes stream past,
+ * so they can be forwarded without buffering the body (chunked bodies are
+ * passed through still chunked)
+ */
+class BodyReader {
+   public:
+    enum class Framing { kNone, kLength, kChunked, kUntilClose };
+
+    /**
+     * @brief Start a new body
+     * @param `framing` how the body is delimited
+     * @param `length` body length for `kLength`
+     */
+    void start(Framing framing, uint64_t length = 0);
+
+    /**
+     * @brief Scan received bytes
+     * @param `in` bytes received after the head (or after the previous call)
+     * @return how many bytes of `in` belong to the body
+     */
+    size_t consume(std::string_view in);
+
+    bool done() const { return done_; }
+    bool failed() const { return failed_; }
+    bool until_close() const { return framing_ == Framing::kUntilClose; }
+
+   private:
+    enum class State { kData, kSize, kDataEnd, kTrailer };
+
+    Framing framing_ = Framing::kNone;
+    State state_ = State::kData;
+    uint64_t remaining_ = 0;
+    // chunk size line being parsed
+    uint64_t chunk_size_ = 0;
+    bool in_extension_ = false;
+    size_t line_length_ = 0;
+    // a CR was read, so the next byte must be LF
+    bool cr_ = false;
+    bool done_ = true;
+    bool failed_ = false;
+};
+
+/**
+ * Reverse-proxy route target: `server.route("/api", "GET", proxy)` forwards
+ * matching HTTP/1.1 requests to one of the proxy's upstreams.
+ *
+ * The exchange is driven by the server's epoll loop like any other
+ * connection: the request body is streamed to the upstream as it arrives and
+ * the response streamed back, and only one side of the exchange is waiting
+ * for events at any time (reading stops while the other side catches up).
+ * Upstream connections are kept alive in per-worker pools; requests go to the
+ * healthy upstream with the fewest requests in flight, and an upstream that
+ * fails `max_failures` times in a row is ejected for `ejection_time`.
+ *
+ * `before` middleware runs as for local handlers; `after` middleware sees the
+ * upstream's status and headers (the body is streamed past it). Requests with
+ * a chunked body are refused with 411.
+ */
+class Proxy {
+   public:
+    explicit Proxy(ProxyOptions options = {});
+    Proxy(const Proxy&) = delete;
+    Proxy& operator=(const Proxy&) = delete;
+
+    /**
+     * @brief Add a TCP upstream
+     * @param `host` hostname or address
+     * @param `port` the port
+     */
+    void add_tcp(const std::string& host, int port);
+
+    /**
+     * @brief Add a Unix domain socket upstream
+     * @param `path` filesystem path of the socket
+     */
+    void add_unix(const std::string& path);
+
+    /**
+     * @brief Add an abstract-namespace Unix socket upstream
+     * @param `name` socket name, without the leading NUL byte
+     */
+    void add_abstract(const std::string& name);
+
+    // ** used by Server **
+
+    /**
+     * @brief Resolve upstream addresses (blocking; called once on start)
+     * @return false if there are no upstreams or one can't be resolved
+     */
+    bool resolve();
+
+    /**
+     * @brief Pick the healthy upstream with the fewest requests in flight
+     * (any upstream, if all are ejected)
+     */
+    Upstream* select();
+
+    /**
+     * @brief Take an idle keep-alive connection from the calling worker's pool
+     * @return the socket, or -1 if there is none
+     */
+    int take_idle(Upstream* upstream);
+
+    /**
+     * @brief Return a connection to the calling worker's pool (or close it if
+     * the pool is full)
+     */
+    void put_idle(Upstream* upstream, int fd);
+
+    /**
+     * @brief Open a non-blocking connection
+     * @param `in_progress` set if the connect has not completed yet
+     * @return the socket, or -1 on failure
+     */
+    int connect(Upstream* upstream, bool* in_progress);
+
+    /**
+     * @brief Record the outcome of an exchange (for ejection)
+     */
+    void report(Upstream* upstream, bool ok);
+
+    /**
+     * @brief Render the head of a request to forward (hop-by-hop headers
+     * removed, the client appended to `X-Forwarded-For`)
+     * @param `secure` whether the client connection uses TLS
+     */
+    static std::string render_request(const Request& request, bool secure);
+
+    /**
+     * @brief Parse an upstream response head
+     * @param `head` the head, including the terminating empty line
+     * @param `method` the request method (responses to HEAD have no body)
+     * @param `body` set up to find the end of the response body
+     * @param `keep_alive` set if the connection can be reused afterwards
+     * @return status and end-to-end headers, or std::nullopt if malformed
+     */
+    static std::optional<Response> parse_response(std::string_view head,
+                                                  std::string_view method,
+                                                  BodyReader* body,
+                                                  bool* keep_alive);
+
+   private:
+    void add(Listener address);
+
+    ProxyOptions options_;
+    std::vector<std::unique_ptr<Upstream>> upstreams_;
+    // rotates where `select` starts, so ties are spread out
+    std::atomic<uint32_t> next_ = 0;
+};
+
+/**
+ * @brief State of one request forwarded over an upstream connection; lives on
+ * the upstream's `Connection`
+ */
+struct ProxyExchange {
+    // set on upstream connections only
+    Proxy* proxy = nullptr;
+    Upstream* upstream = nullptr;
+
+    // head of the proxied request, and how many `after` hooks to run
+    Request request;
+    size_t afters = 0;
+    // request body bytes still to be read from the client
+    uint64_t body_left = 0;
+
+    // non-blocking connect still in progress
+    bool connecting = false;
+    // response head already queued for the client
+    bool responding = false;
+    // close the client connection after the response
+    bool client_closing = false;
+    // the upstream connection can be pooled after the response
+    bool keep_alive = false;
+    BodyReader body;
+    // for the access log: the response status, and body bytes relayed
+    uint16_t status = 0;
+    uint64_t relayed = 0;
+
+    void reset() { *this = ProxyExchange(); }
+};
+
+}  // namespace brick
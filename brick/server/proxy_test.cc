@@ -0,0 +1,156 @@
+#include "brick/server/proxy.hpp"
+
+#include <gtest/gtest.h>
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace brick {
+namespace {
+
+std::optional<Response> parse(std::string_view head, BodyReader* body,
+                              bool* keep_alive) {
+    return Proxy::parse_response(head, "GET", body, keep_alive);
+}
+
+TEST(ParseResponseTest, ReadsContentLength) {
+    BodyReader body;
+    bool keep_alive;
+    std::optional<Response> response =
+        parse("HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\n", &body,
+              &keep_alive);
+    ASSERT_TRUE(response);
+    EXPECT_EQ(response->status_code(), 200);
+    EXPECT_TRUE(keep_alive);
+    EXPECT_EQ(body.consume("helloHTTP/1.1"), 5);
+    EXPECT_TRUE(body.done());
+}
+
+TEST(ParseResponseTest, AcceptsRepeatedEqualLengths) {
+    BodyReader body;
+    bool keep_alive;
+    std::optional<Response> response = parse(
+        "HTTP/1.1 200 OK\r\nContent-Length: 2\r\nContent-Length: 2\r\n\r\n",
+        &body, &keep_alive);
+    ASSERT_TRUE(response);
+    EXPECT_EQ(response->headers().at("Content-Length"), "2");
+}
+
+TEST(ParseResponseTest, KeepsSetCookieLinesApart) {
+    BodyReader body;
+    bool keep_alive;
+    std::optional<Response> response =
+        parse("HTTP/1.1 200 OK\r\nContent-Length: 0\r\n"
+              "Set-Cookie: a=1; Expires=Wed, 21 Oct 2015 07:28:00 GMT\r\n"
+              "Vary: Accept\r\nSet-Cookie: b=2\r\nVary: Origin\r\n\r\n",
+              &body, &keep_alive);
+    ASSERT_TRUE(response);
+
+    std::string head = response->head();
+    EXPECT_NE(head.find("\r\nSet-Cookie: a=1; Expires=Wed, 21 Oct 2015 "
+                        "07:28:00 GMT\r\n"),
+              std::string::npos)
+        << head;
+    EXPECT_NE(head.find("\r\nSet-Cookie: b=2\r\n"), std::string::npos)
+        << head;
+    // other fields may still be joined
+    EXPECT_NE(head.find("\r\nVary: Accept, Origin\r\n"), std::string::npos)
+        << head;
+}
+
+TEST(ParseResponseTest, RejectsAmbiguousFraming) {
+    for (std::string_view head : {
+             "HTTP/1.1 200 OK\r\nContent-Length: -1\r\n\r\n",
+             "HTTP/1.1 200 OK\r\nContent-Length: 18446744073709551616\r\n\r\n",
+             "HTTP/1.1 200 OK\r\nContent-Length: 12abc\r\n\r\n",
+             "HTTP/1.1 200 OK\r\nContent-Length: 2, 3\r\n\r\n",
+             "HTTP/1.1 200 OK\r\nContent-Length: 2\r\nContent-Length: 3\r\n\r\n",
+             "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n"
+             "Transfer-Encoding: chunked\r\n\r\n",
+         }) {
+        BodyReader body;
+        bool keep_alive;
+        EXPECT_FALSE(parse(head, &body, &keep_alive)) << head;
+    }
+}
+
+// feeds `in` one byte at a time, as if every byte arrived separately
+size_t consume_bytes(BodyReader* body, std::string_view in) {
+    size_t consumed = 0;
+    for (char c : in) {
+        if (body->done()) break;
+        consumed += body->consume(std::string_view(&c, 1));
+    }
+    return consumed;
+}
+
+TEST(BodyReaderTest, ReadsChunkedBody) {
+    std::string_view in =
+        "5;name=value\r\nhello\r\n1A\r\n"
+        "abcdefghijklmnopqrstuvwxyz\r\n0\r\nTrailer: x\r\n\r\n";
+    for (bool bytewise : {false, true}) {
+        BodyReader body;
+        body.start(BodyReader::Framing::kChunked);
+        std::string next = std::string(in) + "GET";
+        size_t consumed =
+            bytewise ? consume_bytes(&body, next) : body.consume(next);
+        EXPECT_EQ(consumed, in.size());
+        EXPECT_TRUE(body.done());
+        EXPECT_FALSE(body.failed());
+    }
+}
+
+TEST(BodyReaderTest, ReadsLengthBody) {
+    BodyReader body;
+    body.start(BodyReader::Framing::kLength, 5);
+    EXPECT_EQ(body.consume("hel"), 3);
+    EXPECT_FALSE(body.done());
+    EXPECT_EQ(body.consume("loHTTP"), 2);
+    EXPECT_TRUE(body.done());
+}
+
+TEST(BodyReaderTest, RejectsMalformedChunks) {
+    for (std::string_view in : {
+             // no size, or a size that isn't hex
+             "\r\nhello\r\n0\r\n\r\n",
+             ";ext\r\n",
+             "zz\r\nhello\r\n0\r\n\r\n",
+             "-5\r\nhello\r\n",
+             "5x\r\nhello\r\n",
+             // larger than we accept, and overflowing 64 bits
+             "10000000001\r\n",
+             "1ffffffffffffffff0\r\n",
+             // the size line or the data not ended by CRLF
+             "5\nhello\r\n",
+             "5\rhello\r\n",
+             "5\r\nhelloXX\r\n",
+             "5\r\nhello\n0\r\n\r\n",
+         }) {
+        for (bool bytewise : {false, true}) {
+            BodyReader body;
+            body.start(BodyReader::Framing::kChunked);
+            if (bytewise) {
+                consume_bytes(&body, in);
+            } else {
+                body.consume(in);
+            }
+            EXPECT_TRUE(body.failed()) << in;
+            EXPECT_TRUE(body.done()) << in;
+        }
+    }
+}
+
+TEST(BodyReaderTest, RejectsEndlessLines) {
+    BodyReader body;
+    body.start(BodyReader::Framing::kChunked);
+    body.consume("5;" + std::string(10000, 'x'));
+    EXPECT_TRUE(body.failed());
+
+    body.start(BodyReader::Framing::kChunked);
+    body.consume("0\r\nTrailer: " + std::string(10000, 'x'));
+    EXPECT_TRUE(body.failed());
+}
+
+}  // namespace
+}  // namespace brick
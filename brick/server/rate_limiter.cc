@@ -0,0 +1,100 @@
+#include "rate_limiter.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <optional>
+#include <string>
+
+namespace brick {
+
+RateLimiter::RateLimiter(RateLimit limit, Scope scope, size_t max_keys)
+    : limit_(limit),
+      scope_(scope),
+      shard_size_(std::max(kGroupSize, max_keys / kShards)),
+      shards_(std::make_unique<Shard[]>(kShards)),
+      rejection_(429) {
+    for (size_t i = 0; i < kShards; i++) {
+        // value-initialized: every slot starts empty (key 0)
+        shards_[i].buckets = std::make_unique<Bucket[]>(shard_size_);
+    }
+
+    // rendered once; rejected requests only copy it
+    rejection_.set_header(
+        "Retry-After",
+        std::to_string(static_cast<long>(
+            std::max(1.0, std::ceil(1 / std::max(limit_.rate, 1e-3))))));
+    rejection_.set_body("Too Many Requests");
+}
+
+bool RateLimiter::allow(uint64_t key) {
+    if (key == 0) key = 1;  // 0 marks an empty slot
+    int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now().time_since_epoch())
+                      .count();
+
+    // high bits pick the shard, low bits the home slot within it
+    Shard& shard = shards_[key >> 58 & (kShards - 1)];
+    size_t home = key % shard_size_;
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    Bucket* victim = nullptr;
+    int victim_rank = 0;
+    for (size_t i = 0; i < kGroupSize; i++) {
+        Bucket& bucket = shard.buckets[(home + i) % shard_size_];
+        // lazy refill for the time since the last check
+        double elapsed = static_cast<double>(now - bucket.last) * 1e-9;
+        double tokens = bucket.tokens + elapsed * limit_.rate;
+        if (bucket.key == key) {
+            bucket.tokens = std::min(limit_.burst, tokens);
+            bucket.last = now;
+            if (bucket.tokens < 1) return false;
+            bucket.tokens -= 1;
+            return true;
+        }
+
+        // where a new key goes: an empty slot, else a bucket that has
+        // refilled (its key would start over with a full one anyway), else
+        // the least recently checked bucket - whose key loses its limit
+        int rank = bucket.key == 0 ? 0 : tokens >= limit_.burst ? 1 : 2;
+        if (victim == nullptr || rank < victim_rank ||
+            (rank == victim_rank && bucket.last < victim->last)) {
+            victim = &bucket;
+            victim_rank = rank;
+        }
+    }
+
+    // new key: starts with a full bucket
+    victim->key = key;
+    victim->tokens = limit_.burst - 1;
+    victim->last = now;
+    return victim->tokens >= 0;
+}
+
+bool RateLimiter::allow(const Request& request) {
+    std::hash<std::string_view> hash;
+    uint64_t key = 0;
+    if (scope_ != Scope::kRoute) {
+        key = hash(request.remote_address());
+    }
+    if (scope_ != Scope::kClient) {
+        // the path, without the query string
+        std::string route = request.route();
+        std::string_view path = route;
+        path = path.substr(0, path.find('?'));
+        key = (key * 0x9E3779B97F4A7C15ULL) ^ hash(path);
+    }
+    return allow(key);
+}
+
+Middleware RateLimiter::middleware() {
+    return {[this](const Request& request,
+                   Context&) -> std::optional<Response> {
+                if (allow(request)) return std::nullopt;
+                return rejection_;
+            },
+            nullptr};
+}
+
+}  // namespace brick
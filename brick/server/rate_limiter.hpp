@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+
+#include "brick/request/request.hpp"
+#include "brick/response/response.hpp"
+#include "brick/server/middleware.hpp"
+
+namespace brick {
+
+struct RateLimit {
+    // sustained requests per second
+    double rate = 10;
+    // requests allowed in a burst (bucket capacity)
+    double burst = 20;
+};
+
+/**
+ * Token-bucket rate limiter for tens of thousands of keys (clients, routes or
+ * both), shared by all workers.
+ *
+ * Buckets live in a fixed-size hash table split into cache-line-aligned
+ * shards, each with its own lock, so concurrent checks rarely contend.
+ * Buckets are refilled lazily when checked (no timer thread), and only a
+ * 64-bit hash of the key is stored, so a check never allocates. A key maps to
+ * a small group of slots; when the group is full, a bucket that has refilled
+ * is evicted (its key loses nothing), and only when there is none the least
+ * recently used one - whose key then starts over with a full bucket.
+ */
+class RateLimiter {
+   public:
+    // what a bucket is keyed by
+    enum class Scope { kClient, kRoute, kClientAndRoute };
+
+    /**
+     * @brief Constructor for RateLimiter
+     * @param `limit` the limit applied to every key
+     * @param `scope` what requests are keyed by
+     * @param `max_keys` table size (buckets kept at once)
+     */
+    explicit RateLimiter(RateLimit limit, Scope scope = Scope::kClient,
+                         size_t max_keys = 1 << 16);
+
+    RateLimiter(const RateLimiter&) = delete;
+    RateLimiter& operator=(const RateLimiter&) = delete;
+
+    /**
+     * @brief Take one token from a key's bucket
+     * @param `key` hash of the key
+     * @return true if the request is within the limit
+     */
+    bool allow(uint64_t key);
+
+    /**
+     * @brief Take one token for a request
+     * @return true if the request is within the limit
+     */
+    bool allow(const Request& request);
+
+    /**
+     * @brief Middleware that answers requests over the limit with a 429
+     * (built once, up front) before the handler runs. The limiter must
+     * outlive the server.
+     */
+    Middleware middleware();
+
+   private:
+    struct Bucket {
+        uint64_t key;  // 0 for an empty slot
+        double tokens;
+        int64_t last;  // last check (steady clock, ns)
+    };
+
+    // padded so neighbouring shards' locks never share a cache line
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        std::unique_ptr<Bucket[]> buckets;
+    };
+
+    // slots a key may occupy, starting at its home slot (one cache line
+    // holds ~2.7 buckets, so this touches three lines)
+    static constexpr size_t kGroupSize = 8;
+    static constexpr size_t kShards = 64;
+
+    RateLimit limit_;
+    Scope scope_;
+    size_t shard_size_;
+    std::unique_ptr<Shard[]> shards_;
+    Response rejection_;
+};
+
+}  // namespace brick
@@ -0,0 +1,48 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+#include "brick/server/rate_limiter.hpp"
+
+namespace brick {
+namespace {
+
+// one limiter shared by every benchmark thread, like the workers share one;
+// the limit is high enough that checks are never rejected
+RateLimiter& limiter() {
+    static RateLimiter shared({1e12, 1e12});
+    return shared;
+}
+
+// a stand-in for the key hash `allow(const Request&)` computes
+uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// every thread checks its own rotating set of clients: the usual case, where
+// threads land on different shards
+void BM_AllowDistinctKeys(benchmark::State& state) {
+    uint64_t base = static_cast<uint64_t>(state.thread_index()) << 32;
+    uint64_t i = 0;
+    for (auto _ : state) {
+        // 4096 clients per thread
+        benchmark::DoNotOptimize(limiter().allow(mix(base + (i++ & 0xFFF))));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_AllowDistinctKeys)->ThreadRange(1, 16)->UseRealTime();
+
+// every thread checks the same client: all of them take one shard's lock
+void BM_AllowSameKey(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(limiter().allow(mix(42)));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_AllowSameKey)->ThreadRange(1, 16)->UseRealTime();
+
+}  // namespace
+}  // namespace brick
@@ -0,0 +1,121 @@
+#include "brick/server/rate_limiter.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "brick/request/context.hpp"
+#include "brick/request/request.hpp"
+
+namespace brick {
+namespace {
+
+Request request(const std::string& address, const std::string& target) {
+    Request request("GET " + target + " HTTP/1.1\r\nHost: x\r\n\r\n");
+    request.set_remote_address(address);
+    return request;
+}
+
+// allowed checks out of `tries` back-to-back ones
+int allowed(RateLimiter& limiter, uint64_t key, int tries) {
+    int count = 0;
+    for (int i = 0; i < tries; i++) {
+        if (limiter.allow(key)) count++;
+    }
+    return count;
+}
+
+// (a rate this low never refills within a test)
+constexpr double kNoRefill = 1e-6;
+
+TEST(RateLimiterTest, AllowsBurstThenRejects) {
+    RateLimiter limiter({kNoRefill, 3});
+    Middleware middleware = limiter.middleware();
+    Request client = request("10.0.0.1", "/");
+    Context context;
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(middleware.before(client, context), std::nullopt) << i;
+    }
+    std::optional<Response> rejected = middleware.before(client, context);
+    ASSERT_TRUE(rejected);
+    EXPECT_EQ(rejected->status_code(), 429);
+    EXPECT_FALSE(rejected->header("Retry-After").empty());
+
+    // other clients have their own buckets
+    EXPECT_EQ(middleware.before(request("10.0.0.2", "/"), context),
+              std::nullopt);
+}
+
+TEST(RateLimiterTest, RefillsOverTime) {
+    // a token every 10ms
+    RateLimiter limiter({100, 2});
+    EXPECT_EQ(allowed(limiter, 42, 3), 2);
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    EXPECT_TRUE(limiter.allow(42));
+    // never past the burst, however long it waits
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_EQ(allowed(limiter, 42, 5), 2);
+}
+
+TEST(RateLimiterTest, KeysByScope) {
+    RateLimit limit = {kNoRefill, 1};
+    {
+        RateLimiter limiter(limit, RateLimiter::Scope::kClient);
+        EXPECT_TRUE(limiter.allow(request("10.0.0.1", "/a")));
+        EXPECT_FALSE(limiter.allow(request("10.0.0.1", "/b")));
+        EXPECT_TRUE(limiter.allow(request("10.0.0.2", "/a")));
+    }
+    {
+        RateLimiter limiter(limit, RateLimiter::Scope::kRoute);
+        EXPECT_TRUE(limiter.allow(request("10.0.0.1", "/a?x=1")));
+        // the query string is not part of the route
+        EXPECT_FALSE(limiter.allow(request("10.0.0.2", "/a?x=2")));
+        EXPECT_TRUE(limiter.allow(request("10.0.0.1", "/b")));
+    }
+    {
+        RateLimiter limiter(limit, RateLimiter::Scope::kClientAndRoute);
+        EXPECT_TRUE(limiter.allow(request("10.0.0.1", "/a")));
+        EXPECT_FALSE(limiter.allow(request("10.0.0.1", "/a?x=1")));
+        EXPECT_TRUE(limiter.allow(request("10.0.0.1", "/b")));
+        EXPECT_TRUE(limiter.allow(request("10.0.0.2", "/a")));
+    }
+}
+
+// with no room for more than one group per shard, keys 1..9 (whose high
+// bits all pick shard 0) compete for the same 8 slots
+
+TEST(RateLimiterTest, EvictsLeastRecentlyUsedWhenNoneRefilled) {
+    RateLimiter limiter({kNoRefill, 2}, RateLimiter::Scope::kClient, 0);
+    for (uint64_t key = 1; key <= 8; key++) {
+        EXPECT_TRUE(limiter.allow(key));
+    }
+    EXPECT_TRUE(limiter.allow(9));  // evicts key 1
+
+    // key 8 kept its bucket (one token left)...
+    EXPECT_EQ(allowed(limiter, 8, 2), 1);
+    // ...key 1 starts over with a full one (evicting key 2)
+    EXPECT_EQ(allowed(limiter, 1, 3), 2);
+}
+
+TEST(RateLimiterTest, EvictsRefilledBucketsFirst) {
+    // a token every 10ms, and room for 10
+    RateLimiter limiter({100, 10}, RateLimiter::Scope::kClient, 0);
+    // key 1 is the least recently used, and far from refilled
+    EXPECT_EQ(allowed(limiter, 1, 10), 10);
+    // key 2 only used one token, so it has refilled by the time key 9 comes
+    EXPECT_TRUE(limiter.allow(2));
+    for (uint64_t key = 3; key <= 8; key++) {
+        EXPECT_EQ(allowed(limiter, key, 10), 10);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_TRUE(limiter.allow(9));  // evicts key 2, not key 1
+
+    // key 1 is still limited: only what it refilled since
+    EXPECT_LT(allowed(limiter, 1, 10), 10);
+}
+
+}  // namespace
+}  // namespace brick
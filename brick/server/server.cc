@@ -2,19 +2,36 @@
 
 #include <arpa/inet.h>
 #include <netdb.h>
+#include <netinet/tcp.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
 #include <unistd.h>
 
 #include <csignal>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
 #include <cstring>
 #include <functional>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <utility>
+#include <vector>
 
+#include "brick/http2/session.hpp"
 #include "brick/request/request.hpp"
 #include "brick/response/response.hpp"
+#include "brick/server/framing.hpp"
+#include "brick/server/handoff.hpp"
+#include "brick/utils/logging/logger.hpp"
+#include "brick/utils/tracing/tracing.hpp"
 
 #define MAX_REQUEST_SIZE (10 * 1024)  // 10KB, including null terminator
 
@@ -22,19 +39,146 @@ namespace brick {
 
 // volatile sig_atomic_t serving_ = 1; // NOLINT
 
+namespace {
+
+// request ids are (worker << 40 | per-worker sequence), so workers never
+// contend on a shared counter
+std::atomic<uint64_t> next_worker_id = 0;
+thread_local uint64_t worker_id = 0;
+thread_local uint64_t request_sequence = 0;
+
+uint64_t next_request_id() { return (worker_id << 40) | ++request_sequence; }
+
+// index of the calling worker within its server, and of its shard
+thread_local size_t worker_index = 0;
+thread_local size_t worker_shard = 0;
+
+// client address as text; IPv4 clients of a dual-stack listener are shown
+// as plain IPv4. `ip` gets the binary form, with IPv4 v4-mapped.
+void format_address(const struct sockaddr_storage& addr, std::string* out,
+                    struct in6_addr* ip) {
+    char buf[INET6_ADDRSTRLEN];
+    const char* text = "unix";
+    *ip = {};
+    if (addr.ss_family == AF_INET) {
+        const auto* in = reinterpret_cast<const struct sockaddr_in*>(&addr);
+        text = inet_ntop(AF_INET, &in->sin_addr, buf, sizeof(buf));
+        ip->s6_addr[10] = 0xff;
+        ip->s6_addr[11] = 0xff;
+        memcpy(&ip->s6_addr[12], &in->sin_addr, 4);
+    } else if (addr.ss_family == AF_INET6) {
+        const auto* in6 = reinterpret_cast<const struct sockaddr_in6*>(&addr);
+        text = IN6_IS_ADDR_V4MAPPED(&in6->sin6_addr)
+                   ? inet_ntop(AF_INET, &in6->sin6_addr.s6_addr[12], buf,
+                               sizeof(buf))
+                   : inet_ntop(AF_INET6, &in6->sin6_addr, buf, sizeof(buf));
+        *ip = in6->sin6_addr;
+    }
+    out->assign(text != nullptr ? text : "");
+}
+
+// coarse monotonic clock for idle deadlines, in seconds
+uint32_t idle_clock() {
+    return static_cast<uint32_t>(
+        std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
+// take a connection from the idle sweep before handling an event for it:
+// false if the handle is stale or the sweep has claimed the connection
+bool take(ConnectionHandle handle, Connection* conn) {
+    uint64_t generation = handle & ~0xFFFFFFFFULL;
+    uint64_t state = conn->idle.load(std::memory_order_acquire);
+    do {
+        if ((state & ~0xFFFFFFFFULL) != generation ||
+            (state & 0xFFFFFFFF) == kIdleExpired) {
+            return false;
+        }
+        if ((state & 0xFFFFFFFF) == kIdleBusy) return true;
+    } while (!conn->idle.compare_exchange_weak(state, generation | kIdleBusy,
+                                               std::memory_order_acquire));
+    return true;
+}
+
+}  // namespace
+
 void Server::route(const std::string& path, const std::string& method,
                    Handler handler) {
     router_[method][path] = std::move(handler);
 }
 
-void Server::start(int port = 8080) {
-    init(port);
+void Server::route(const std::string& path, const std::string& method,
+                   std::shared_ptr<Proxy> proxy) {
+    proxy_routes_[method][path] = std::move(proxy);
+}
+
+void Server::use(Middleware middleware) {
+    middleware_.push_back(std::move(middleware));
+}
+
+void Server::enable_hot_restart(const std::string& handoff_path) {
+    handoff_path_ = handoff_path;
+}
+
+void Server::set_socket_options(const SocketOptions& options) {
+    socket_options_ = options;
+}
+
+void Server::set_keep_alive_timeout(std::chrono::seconds timeout) {
+    keep_alive_timeout_ = timeout;
+}
+
+void Server::set_worker_options(const WorkerOptions& options) {
+    worker_options_ = options;
+}
+
+void Server::listen_tcp(int port, const std::string& host) {
+    listeners_.push_back({Listener::Kind::kTcp, host, port});
+}
+
+void Server::enable_tracing(const std::string& dump_path) {
+    trace_path_ = dump_path;
+}
+
+void Server::enable_access_log(const AccessLogOptions& options) {
+    access_log_options_ = options;
+}
+
+void Server::enable_tls(const tls::TlsOptions& options) {
+    tls_options_ = options;
+}
+
+void Server::listen_tls(int port, const std::string& host) {
+    listeners_.push_back({Listener::Kind::kTcp, host, port, true});
+}
+
+void Server::listen_unix(const std::string& path) {
+    listeners_.push_back({Listener::Kind::kUnix, path});
+}
+
+void Server::listen_abstract(const std::string& name) {
+    listeners_.push_back({Listener::Kind::kAbstract, name});
+}
+
+void Server::start(int port) {
+    listen_tcp(port);
+    start();
+}
+
+void Server::start() {
+    init();
+    if (!trace_path_.empty()) {
+        trace::enable();
+    }
     // threads should not receive SIGINT or SIGPIPE
     block_signals();
 
     // populate pool!
-    for (size_t i = 0; i < pool_.capacity(); i++) {
-        pool_.emplace_back(&Server::process_events, this);
+    for (size_t shard = 0; shard < shards_.size(); shard++) {
+        for (unsigned int i = 0; i < shards_[shard]->workers; i++) {
+            pool_.emplace_back(&Server::process_events, this, shard);
+        }
     }
 
     // handle sigints using sigwait
@@ -43,12 +187,25 @@ void Server::start(int port = 8080) {
 
     sigemptyset(&set);
     sigaddset(&set, SIGINT);
+    if (!trace_path_.empty()) {
+        sigaddset(&set, SIGUSR1);
+    }
     sigprocmask(SIG_BLOCK, &set, nullptr);
 
+    // wake up periodically to close idle connections and, with hot
+    // restarts, to notice when a handoff has finished draining
+    bool sweep = keep_alive_timeout_.count() > 0 || tls_context_ != nullptr;
+    struct timespec timeout = {1, 0};
+    const struct timespec* poll =
+        handoff_path_.empty() && !sweep ? nullptr : &timeout;
     while (serving_) {
-        sigwait(&set, &sig);
-        if (sig == SIGINT) {
+        sig = sigtimedwait(&set, nullptr, poll);
+        if (sig == SIGUSR1) {
+            dump_trace();
+        } else if (sig == SIGINT || drained()) {
             serving_ = 0;
+        } else if (sweep || draining_) {
+            close_idle();
         }
     }
 
@@ -67,60 +224,448 @@ void Server::start(int port = 8080) {
     // sigaction(SIGINT, &sa, nullptr);
 }
 
-void Server::process_events() {
-    struct epoll_event events[kMaxConnections];
+void Server::process_events(size_t shard_index) {
+    // small batches keep the event array and the connections it points at hot
+    // in L1/L2; anything left over is picked up by the next `epoll_wait`
+    struct epoll_event events[kEventBatch];
     int nfds;
 
+    worker_id = next_worker_id++;
+    worker_index = next_worker_index_++;
+    worker_shard = shard_index;
+
+    Shard& shard = *shards_[shard_index];
+    if (worker_options_.numa_aware && !topology::pin(shard.node)) {
+        log::warning("Could not pin worker to NUMA node ", shard.node.id);
+    }
+    int idle_timeout = static_cast<int>(worker_options_.idle_timeout.count());
+    unsigned int min_workers = std::max(worker_options_.min_workers, 1U);
+    // adaptive mode: when this worker's run of back-to-back batches began,
+    // and when its last batch ended
+    auto busy_since = std::chrono::steady_clock::now();
+    auto batch_end = busy_since;
+
     while (serving_) {
-        // timeout is so that we won't say blocked on `epoll_wait` forever after
-        // SIGINT log::debug("Thread ", std::this_thread::get_id(), " waiting
-        // for events..."); // NOLINT
-        nfds = epoll_wait(epoll_fd_, events, kMaxConnections, 1000);
+        // block until there is work; `cleanup` signals `wakeup_fd_` to stop
+        // us. Adaptive workers beyond the minimum give up after a while.
+        int timeout = -1;
+        if (worker_options_.adaptive && shard.active > min_workers) {
+            timeout = idle_timeout;
+        }
+        nfds = epoll_wait(shard.epoll_fd, events, kEventBatch, timeout);
         if (nfds < 0) {
             if (errno == EINTR) continue;
             exit(1);
         }
+        if (nfds == 0) {
+            park(shard);
+            continue;
+        }
+        if (worker_options_.adaptive) {
+            // a full batch most likely left events behind
+            if (nfds == kEventBatch) unpark(shard);
+            auto now = std::chrono::steady_clock::now();
+            if (now - batch_end > kBusyGap) busy_since = now;
+        }
+        trace::wakeup();
+        BRICK_PROBE(wakeup, nfds);
 
         for (int i = 0; i < nfds; i++) {
-            if (events[i].data.fd == socket_fd_) {
-                accept_connection();
+            ConnectionHandle handle = events[i].data.u64;
+            if (handle == kHandoffHandle) {
+                hand_off();
+            } else if (handle == kWakeupHandle) {
+                continue;  // shutting down: `serving_` is already clear
+            } else if ((handle & 0xFFFFFFFF) == ConnectionTable::kNoIndex) {
+                accept_connections(handle >> 32);
             } else {
-                handle_request(events[i].data.fd);
+                handle_event(handle, events[i].events);
+                trace::commit();
+            }
+        }
+
+        // however few connections there are, slow handlers can keep this
+        // worker from getting back to the rest of them
+        if (worker_options_.adaptive) {
+            batch_end = std::chrono::steady_clock::now();
+            if (batch_end - busy_since >= kSaturatedTime) unpark(shard);
+        }
+    }
+}
+
+void Server::park(Shard& shard) {
+    unsigned int min_workers = std::max(worker_options_.min_workers, 1U);
+    unsigned int active = shard.active.load();
+    do {
+        if (active <= min_workers) return;
+    } while (!shard.active.compare_exchange_weak(active, active - 1));
+
+    shard.parked++;
+    shard.unpark.acquire();
+    shard.active++;
+}
+
+void Server::unpark(Shard& shard) {
+    unsigned int parked = shard.parked.load();
+    do {
+        if (parked == 0) return;
+    } while (!shard.parked.compare_exchange_weak(parked, parked - 1));
+    shard.unpark.release();
+}
+
+void Server::accept_connections(size_t listener) {
+    int listen_fd = listen_fds_[listener];
+    bool tcp = listener < listeners_.size() &&
+               listeners_[listener].kind == Listener::Kind::kTcp;
+    bool secure = listener < listeners_.size() && listeners_[listener].tls;
+
+    // edge-triggered: drain the accept queue
+    while (true) {
+        struct sockaddr_storage addr;
+        socklen_t addr_len = sizeof(addr);
+        int client_fd =
+            accept4(listen_fd, reinterpret_cast<struct sockaddr*>(&addr),
+                    &addr_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_fd < 0) {
+            return;
+        }
+
+        // serve the connection on its NIC queue's node
+        size_t shard = steer(client_fd);
+        ConnectionHandle handle;
+        Connection* conn = connections_->acquire(client_fd, &handle, shard);
+        if (conn == nullptr) {
+            log::warning("Connection table full, dropping connection");
+            close(client_fd);
+            continue;
+        }
+        active_connections_++;
+        format_address(addr, &conn->remote_address, &conn->remote_ip);
+        if (tcp) apply_client_options(client_fd);
+        if (secure) {
+            conn->tls = tls::Channel::create(*tls_context_, client_fd);
+            if (conn->tls == nullptr) {
+                remove_client(handle);  // out of memory: drop it
+                continue;
             }
         }
+
+        // a client that never finishes its handshake would hold the slot
+        // (the keep-alive timeout takes over once it is done)
+        conn->waiting_until =
+            secure ? idle_clock() + tls_options_.handshake_timeout_seconds
+                   : idle_deadline();
+        // one-shot: a connection is only ever owned by one worker at a time
+        rearm(handle, conn, EPOLLIN, EPOLL_CTL_ADD);
     }
 }
 
-void Server::accept_connection() const {
-    int client_fd = accept(socket_fd_, nullptr, nullptr);
-    if (client_fd < 0) {
+size_t Server::steer(int fd) const {
+    if (shards_.size() == 1) return 0;
+    int cpu = topology::incoming_cpu(fd);
+    if (cpu >= 0 && static_cast<size_t>(cpu) < cpu_shards_.size() &&
+        cpu_shards_[cpu] >= 0) {
+        return cpu_shards_[cpu];
+    }
+    return worker_shard;
+}
+
+void Server::handle_event(ConnectionHandle handle, uint32_t events) {
+    Connection* conn = connections_->get(handle);
+    if (conn == nullptr || !take(handle, conn)) {
+        return;  // closed (or being closed) since the event was queued
+    }
+
+    if (conn->proxy.upstream != nullptr) {
+        handle_upstream(handle, conn);
         return;
     }
 
-    // TODO(akhil): set client_fd to non-blocking
+    if (!conn->out.empty()) {
+        flush(handle, conn);
+        return;
+    }
 
-    struct epoll_event ev;
-    ev.events = EPOLLIN | EPOLLET;
-    ev.data.fd = client_fd;
+    // client of a proxied exchange: more request body to forward
+    if (conn->peer != kNoConnection) {
+        forward_body(handle, conn);
+        return;
+    }
 
-    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, client_fd, &ev) < 0) {
-        remove_client(client_fd);
+    if (conn->tls != nullptr && !conn->tls->handshake_done() &&
+        !handshake(handle, conn)) {
+        return;
+    }
+
+    if (!read_requests(conn)) {
+        remove_client(handle);
+        return;
+    }
+    trace::mark_read();
+    BRICK_PROBE(read, conn->fd, conn->in.size());
+    if (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+        conn->close_after = true;
+    }
+
+    handle_requests(handle, conn);
+}
+
+bool Server::handshake(ConnectionHandle handle, Connection* conn) {
+    int status = conn->tls->handshake();
+    if (status < 0) {
+        remove_client(handle);
+        return false;
+    }
+    if (status == 0) {
+        rearm(handle, conn, EPOLLIN);  // `rearm` adds EPOLLOUT if needed
+        return false;
+    }
+
+    // HTTP/2 negotiated through ALPN: no preface sniffing or upgrade needed
+    if (conn->tls->alpn() == "h2") {
+        start_http2(conn);
+    }
+    return true;
+}
+
+bool Server::read_requests(Connection* conn) const {
+    char buf[kReadChunk];
+    // stop at a full buffer; the rest stays in the socket until the pipelined
+    // requests already buffered have been answered
+    while (conn->in.size() < input_limit(conn)) {
+        ssize_t size = conn->tls != nullptr
+                           ? conn->tls->read(buf, sizeof(buf))
+                           : recv(conn->fd, buf, sizeof(buf), 0);
+        if (size > 0) {
+            conn->in.append(buf, size);
+            continue;
+        }
+        if (size == 0) {
+            conn->close_after = true;  // peer closed
+            break;
+        }
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) return false;
+        break;
     }
 
+    if (socket_options_.tcp_quickack) {
+        int opt = 1;
+        setsockopt(conn->fd, IPPROTO_TCP, TCP_QUICKACK, &opt, sizeof(opt));
+    }
+    return true;
+}
+
+size_t Server::request_length(std::string_view in, bool* invalid) {
+    *invalid = false;
+    size_t header_end = in.find("\r\n\r\n");
+    if (header_end == std::string_view::npos) return 0;
+
+    // the body length must be unambiguous: a chunked body (not decoded here)
+    // or conflicting lengths could hide a second request inside this one's
+    uint64_t body_length;
+    if (request_framing(in.substr(0, header_end), MAX_REQUEST_SIZE,
+                        &body_length) != BodyFraming::kLength) {
+        *invalid = true;
+        return 0;
+    }
+
+    // (a request that can never fit in the input buffer)
+    size_t length = header_end + 4 + body_length;
+    if (length > MAX_REQUEST_SIZE) {
+        *invalid = true;
+        return 0;
+    }
+    return in.size() >= length ? length : 0;
+}
+
+bool Server::keep_alive(const Request& request) {
+    if (request.has_header("Connection")) {
+        std::string value = request.header("Connection");
+        std::transform(value.begin(), value.end(), value.begin(),
+                       [](uint8_t c) { return std::tolower(c); });
+        if (value == "close") return false;
+        if (value == "keep-alive") return true;
+    }
+    return request.http_version() == "HTTP/1.1";
 }
 
-void Server::handle_request(int client_fd) {
-    char buf[MAX_REQUEST_SIZE];
-    int size = recv(client_fd, buf, MAX_REQUEST_SIZE - 1, 0);
-    if (size < 0) {
-        remove_client(client_fd);
+void Server::handle_requests(ConnectionHandle handle, Connection* conn) {
+    // HTTP/2 with prior knowledge starts with the client preface
+    if (conn->h2 == nullptr) {
+        bool partial;
+        if (http2::Session::is_preface(conn->in, &partial)) {
+            start_http2(conn);
+        } else if (partial) {
+            send_or_wait(handle, conn);
+            return;
+        }
+    }
+    if (conn->h2 != nullptr) {
+        handle_http2(handle, conn);
         return;
     }
-    buf[size] = '\0';
 
-    // build request
-    Request request(buf);
+    // answer every complete request in the buffer; the responses go out
+    // together in one `writev`
+    size_t consumed = 0;
+    while (true) {
+        std::string_view rest = std::string_view(conn->in).substr(consumed);
+
+        // proxied requests start as soon as their head is in; the body is
+        // streamed to the upstream
+        Proxy* proxy = find_proxy(rest);
+        if (proxy != nullptr) {
+            conn->in.erase(0, consumed);
+            consumed = 0;
+            if (start_proxy(handle, conn, *proxy)) return;
+            continue;
+        }
+
+        bool invalid;
+        size_t length = request_length(rest, &invalid);
+        if (invalid) {
+            // where the next request would start is unknown: answer, and
+            // read nothing more from this connection
+            Response response(400);
+            response.set_header("Connection", "close");
+            conn->out.push_back(response.head());
+            conn->out.push_back(response.release_body());
+            conn->close_after = true;
+            consumed = conn->in.size();
+            break;
+        }
+        if (length == 0) break;
+        trace::begin_request();
+        Request request(conn->in.substr(consumed, length));
+        request.set_remote_address(conn->remote_address);
+        consumed += length;
+        trace::mark(trace::kParse);
+        BRICK_PROBE(parse, conn->fd, length);
+
+        // `Upgrade: h2c` - only as the first request, so responses stay in
+        // order
+        std::string settings;
+        if (conn->out.empty() && wants_h2c(request, &settings)) {
+            conn->in.erase(0, consumed);
+            conn->out.emplace_back(
+                "HTTP/1.1 101 Switching Protocols\r\n"
+                "Connection: Upgrade\r\nUpgrade: h2c\r\n\r\n");
+            start_http2(conn);
+            conn->h2->upgrade(std::move(request), settings);
+            handle_http2(handle, conn);
+            return;
+        }
+
+        conn->context.reset(next_request_id());
+        Response response = handle_request(request, conn->context);
+        bool closing = draining_ || !keep_alive(request);
+        if (closing) {
+            response.set_header("Connection", "close");
+        }
+
+        conn->out.push_back(response.head());
+        conn->out.push_back(response.release_body());
+        log_access(conn, request, response.status_code(),
+                   conn->out.back().size());
+        trace::mark(trace::kRender);
+        trace::end_request(conn->context.request_id());
+        BRICK_PROBE(render, conn->context.request_id(),
+                    conn->out.back().size());
+
+        if (closing) {
+            conn->close_after = true;
+            break;
+        }
+    }
+    conn->in.erase(0, consumed);
+
+    send_or_wait(handle, conn);
+}
+
+bool Server::wants_h2c(const Request& request, std::string* settings) {
+    if (request.http_version() != "HTTP/1.1" || !request.has_header("Upgrade") ||
+        !request.has_header("HTTP2-Settings")) {
+        return false;
+    }
+
+    std::string upgrade = request.header("Upgrade");
+    return upgrade.find("h2c") != std::string::npos &&
+           http2::Session::decode_settings_header(
+               request.header("HTTP2-Settings"), settings);
+}
+
+void Server::start_http2(Connection* conn) {
+    // handlers run synchronously, so streams can share the connection's
+    // context
+    conn->h2 = std::make_unique<http2::Session>([this, conn](Request& request) {
+        trace::begin_request();
+        request.set_remote_address(conn->remote_address);
+        conn->context.reset(next_request_id());
+        Response response = handle_request(request, conn->context);
+        log_access(conn, request, response.status_code(),
+                   response.body_size());
+        // HTTP/2 framing happens later, in `take_output`
+        trace::mark(trace::kRender);
+        trace::end_request(conn->context.request_id());
+        return response;
+    });
+}
+
+void Server::handle_http2(ConnectionHandle handle, Connection* conn) {
+    if (draining_) {
+        conn->h2->go_away();
+    }
+
+    size_t consumed = conn->h2->receive(conn->in);
+    conn->in.erase(0, consumed);
 
+    std::string out = conn->h2->take_output();
+    if (!out.empty()) {
+        conn->out.push_back(std::move(out));
+    }
+    if (conn->h2->closed()) {
+        conn->close_after = true;
+    }
+
+    send_or_wait(handle, conn);
+}
+
+void Server::send_or_wait(ConnectionHandle handle, Connection* conn) {
+    if (!conn->out.empty()) {
+        flush(handle, conn);
+    } else if (conn->close_after || conn->in.size() >= input_limit(conn)) {
+        remove_client(handle);  // hung up, or a request that will never fit
+    } else {
+        rearm(handle, conn, EPOLLIN);
+    }
+}
+
+size_t Server::input_limit(const Connection* conn) {
+    if (conn->proxy.upstream != nullptr) {
+        return kProxyChunk;
+    }
+    // HTTP/2 needs room for one full frame
+    return conn->h2 != nullptr
+               ? http2::kFrameHeaderSize + http2::kDefaultMaxFrameSize
+               : MAX_REQUEST_SIZE;
+}
+
+Response Server::handle_request(Request& request, Context& context) {
+    request.set_context(&context);
+
+    size_t afters;
+    std::optional<Response> response =
+        pipeline_.run_befores(request, context, &afters);
+    if (!response) {
+        response = dispatch(request);
+    }
+    pipeline_.run_afters(request, context, *response, afters);
+
+    return std::move(*response);
+}
+
+Response Server::dispatch(const Request& request) {
     // build response
     auto route = request.route();
     auto method = request.method();
@@ -129,109 +674,998 @@ void Server::handle_request(int client_fd) {
 
     if (router_.contains(method) && router_.at(method).contains(route)) {
         auto handler = router_.at(method).at(route);
+        trace::mark(trace::kRoute);
+        BRICK_PROBE(route, route.c_str());
         response = handler(request);
+        trace::mark(trace::kHandler);
+        BRICK_PROBE(handler, response.status_code());
+    } else if (proxy_routes_.contains(method) &&
+               proxy_routes_.at(method).contains(route)) {
+        // only reached over HTTP/2: its streams are answered synchronously,
+        // so they can't wait on an upstream
+        response = Response(501);
+    }
+
+    return response;
+}
+
+Proxy* Server::find_proxy(std::string_view in) const {
+    if (proxy_routes_.empty() ||
+        in.find("\r\n\r\n") == std::string_view::npos) {
+        return nullptr;
+    }
+
+    size_t method_end = in.find(' ');
+    if (method_end == std::string_view::npos) return nullptr;
+    size_t route_end = in.find(' ', method_end + 1);
+    if (route_end == std::string_view::npos) return nullptr;
+
+    auto routes = proxy_routes_.find(std::string(in.substr(0, method_end)));
+    if (routes == proxy_routes_.end()) return nullptr;
+    auto proxy = routes->second.find(
+        std::string(in.substr(method_end + 1, route_end - method_end - 1)));
+    return proxy != routes->second.end() ? proxy->second.get() : nullptr;
+}
+
+bool Server::start_proxy(ConnectionHandle handle, Connection* conn,
+                         Proxy& proxy) {
+    size_t head_length = conn->in.find("\r\n\r\n") + 4;
+    // bodies are streamed, so any length goes, but it must be unambiguous
+    uint64_t body_length = 0;
+    BodyFraming framing =
+        request_framing(std::string_view(conn->in).substr(0, head_length),
+                        UINT64_MAX, &body_length);
+    Request request(conn->in.substr(0, head_length));
+    request.set_remote_address(conn->remote_address);
+    conn->in.erase(0, head_length);
+
+    conn->context.reset(next_request_id());
+    request.set_context(&conn->context);
+
+    bool closing = draining_ || !keep_alive(request);
+
+    size_t afters;
+    std::optional<Response> response =
+        pipeline_.run_befores(request, conn->context, &afters);
+    if (!response && framing == BodyFraming::kTransferEncoding) {
+        response = Response(411);
+    } else if (!response && framing == BodyFraming::kInvalid) {
+        response = Response(400);
+    }
+
+    Upstream* upstream = nullptr;
+    int fd = -1;
+    bool connecting = false;
+    if (!response) {
+        upstream = proxy.select();
+        fd = proxy.take_idle(upstream);
+        if (fd < 0) {
+            fd = proxy.connect(upstream, &connecting);
+        }
+        if (fd < 0) {
+            proxy.report(upstream, false);
+            response = Response(502);
+        }
+    }
+
+    ConnectionHandle upstream_handle;
+    Connection* upstream_conn = nullptr;
+    if (!response) {
+        upstream_conn =
+            connections_->acquire(fd, &upstream_handle, worker_shard);
+        if (upstream_conn == nullptr) {
+            close(fd);
+            response = Response(503);
+        }
+    }
+
+    // answered here; an unread body can't be skipped, so that also ends the
+    // connection
+    if (response) {
+        pipeline_.run_afters(request, conn->context, *response, afters);
+        if (closing || framing != BodyFraming::kLength || body_length > 0) {
+            response->set_header("Connection", "close");
+            conn->close_after = true;
+            conn->in.clear();
+        }
+        conn->out.push_back(response->head());
+        conn->out.push_back(response->release_body());
+        log_access(conn, request, response->status_code(),
+                   conn->out.back().size(), access_log::kProxied);
+        return false;
+    }
+
+    active_connections_++;
+    upstream->outstanding++;
+
+    ProxyExchange& exchange = upstream_conn->proxy;
+    exchange.proxy = &proxy;
+    exchange.upstream = upstream;
+    exchange.afters = afters;
+    exchange.body_left = body_length;
+    exchange.connecting = connecting;
+    exchange.client_closing = closing;
+
+    // the head, and whatever part of the body has already arrived
+    upstream_conn->out.push_back(
+        Proxy::render_request(request, conn->tls != nullptr));
+    uint64_t buffered = std::min<uint64_t>(body_length, conn->in.size());
+    if (buffered > 0) {
+        upstream_conn->out.push_back(conn->in.substr(0, buffered));
+        conn->in.erase(0, buffered);
+        exchange.body_left -= buffered;
+    }
+    if (exchange.body_left > 0 && request.has_header("Expect") &&
+        conn->out.empty()) {
+        conn->out.emplace_back("HTTP/1.1 100 Continue\r\n\r\n");
+    }
+    exchange.request = std::move(request);
+
+    upstream_conn->peer = handle;
+    conn->peer = upstream_handle;
+
+    // the head goes out once the upstream is writable (or connected). Until
+    // the response has been relayed, only one side of the exchange is armed
+    // at a time, so they are never handled concurrently.
+    struct epoll_event ev;
+    ev.events = EPOLLOUT | EPOLLRDHUP | EPOLLONESHOT;
+    ev.data.u64 = upstream_handle;
+    if (epoll_ctl(epoll_fd(upstream_handle), EPOLL_CTL_ADD, fd, &ev) < 0) {
+        remove_client(upstream_handle);
+    }
+    return true;
+}
+
+void Server::forward_body(ConnectionHandle handle, Connection* conn) {
+    ConnectionHandle upstream_handle = conn->peer;
+    Connection* upstream = connections_->get(upstream_handle);
+    ProxyExchange& exchange = upstream->proxy;
+
+    std::string chunk(std::min<uint64_t>(exchange.body_left, kProxyChunk),
+                      '\0');
+    size_t size = 0;
+    while (size < chunk.size()) {
+        ssize_t n = conn->tls != nullptr
+                        ? conn->tls->read(chunk.data() + size,
+                                          chunk.size() - size)
+                        : recv(conn->fd, chunk.data() + size,
+                               chunk.size() - size, 0);
+        if (n > 0) {
+            size += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        remove_client(handle);  // the client gave up halfway through the body
+        return;
+    }
+
+    if (size == 0) {
+        rearm(handle, conn, EPOLLIN);
+        return;
+    }
+    chunk.resize(size);
+    exchange.body_left -= size;
+    upstream->out.push_back(std::move(chunk));
+    flush(upstream_handle, upstream);
+}
+
+void Server::handle_upstream(ConnectionHandle handle, Connection* conn) {
+    if (conn->proxy.connecting) {
+        int error = 0;
+        socklen_t len = sizeof(error);
+        getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &error, &len);
+        if (error != 0) {
+            remove_client(handle);
+            return;
+        }
+        conn->proxy.connecting = false;
+    }
+
+    if (!conn->out.empty()) {
+        flush(handle, conn);
+        return;
+    }
+
+    if (!read_requests(conn)) {
+        remove_client(handle);
+        return;
+    }
+    relay_response(handle, conn);
+}
+
+void Server::relay_response(ConnectionHandle handle, Connection* conn) {
+    ProxyExchange& exchange = conn->proxy;
+    Connection* client = connections_->get(conn->peer);
+
+    // skip interim (1xx) responses; the final head goes through the `after`
+    // middleware
+    while (!exchange.responding) {
+        size_t head_end = conn->in.find("\r\n\r\n");
+        if (head_end == std::string::npos) {
+            if (conn->close_after || conn->in.size() >= kProxyChunk) {
+                remove_client(handle);
+            } else {
+                rearm(handle, conn, EPOLLIN);
+            }
+            return;
+        }
+
+        std::optional<Response> response = Proxy::parse_response(
+            std::string_view(conn->in).substr(0, head_end + 4),
+            exchange.request.method(), &exchange.body, &exchange.keep_alive);
+        if (!response) {
+            remove_client(handle);
+            return;
+        }
+        conn->in.erase(0, head_end + 4);
+        if (response->status_code() < 200) {
+            continue;
+        }
+
+        pipeline_.run_afters(exchange.request, client->context, *response,
+                             exchange.afters);
+        if (exchange.client_closing || exchange.body.until_close()) {
+            response->set_header("Connection", "close");
+            exchange.client_closing = true;
+        }
+        client->out.push_back(response->head());
+        exchange.responding = true;
+        exchange.status = static_cast<uint16_t>(response->status_code());
     }
 
-    std::string ans = response.raw();
+    // pass the body through as it arrives
+    size_t length = exchange.body.consume(conn->in);
+    if (exchange.body.failed()) {
+        remove_client(handle);
+        return;
+    }
+    bool clean = length == conn->in.size();
+    exchange.relayed += length;
+    if (clean) {
+        if (length > 0) client->out.push_back(std::move(conn->in));
+        conn->in.clear();
+    } else {
+        client->out.push_back(conn->in.substr(0, length));
+        conn->in.erase(0, length);
+    }
+
+    if (exchange.body.done() ||
+        (exchange.body.until_close() && conn->close_after)) {
+        // bytes past the end of the response: don't trust the connection
+        finish_proxy(handle, conn,
+                     exchange.keep_alive && clean && !conn->close_after);
+        return;
+    }
+    if (conn->close_after) {
+        remove_client(handle);  // truncated
+        return;
+    }
+    if (client->out.empty()) {
+        rearm(handle, conn, EPOLLIN);
+        return;
+    }
+    // backpressure: the upstream is read again once the client caught up
+    flush(conn->peer, client);
+}
+
+void Server::proxy_flushed(ConnectionHandle handle, Connection* conn) {
+    bool is_upstream = conn->proxy.upstream != nullptr;
+    ConnectionHandle upstream_handle = is_upstream ? handle : conn->peer;
+    ConnectionHandle client_handle = is_upstream ? conn->peer : handle;
+    Connection* upstream =
+        is_upstream ? conn : connections_->get(upstream_handle);
+    Connection* client = is_upstream ? connections_->get(client_handle) : conn;
+
+    if (upstream->proxy.body_left > 0) {
+        // more request body to read from the client
+        rearm(client_handle, client, client->out.empty() ? EPOLLIN : EPOLLOUT);
+    } else {
+        // request sent, or the client caught up with the response
+        rearm(upstream_handle, upstream, EPOLLIN);
+    }
+}
+
+void Server::finish_proxy(ConnectionHandle handle, Connection* conn,
+                          bool reuse) {
+    ConnectionHandle client_handle = conn->peer;
+    Connection* client = connections_->get(client_handle);
+    Proxy* proxy = conn->proxy.proxy;
+    Upstream* upstream = conn->proxy.upstream;
+    bool closing = conn->proxy.client_closing;
+
+    proxy->report(upstream, true);
+    log_access(client, conn->proxy.request, conn->proxy.status,
+               conn->proxy.relayed, access_log::kProxied);
+    conn->peer = kNoConnection;
+    client->peer = kNoConnection;
+
+    if (reuse) {
+        epoll_ctl(epoll_fd(handle), EPOLL_CTL_DEL, conn->fd, nullptr);
+        upstream->outstanding--;
+        proxy->put_idle(upstream, conn->fd);
+        connections_->release(handle);
+        active_connections_--;
+    } else {
+        remove_client(handle);
+    }
+
+    // carry on with requests the client pipelined behind this one
+    if (closing) {
+        client->close_after = true;
+        client->in.clear();
+    }
+    handle_requests(client_handle, client);
+}
+
+void Server::fail_proxy(ConnectionHandle handle, bool responding,
+                        bool closing) {
+    Connection* conn = connections_->get(handle);
+    if (conn == nullptr) return;
+
+    // part of the response is out: only closing tells the client it was cut
+    if (responding) {
+        conn->close_after = true;
+        send_or_wait(handle, conn);
+        return;
+    }
+
+    Response response(502);
+    if (closing) {
+        response.set_header("Connection", "close");
+        conn->close_after = true;
+        conn->in.clear();
+    }
+    conn->out.push_back(response.head());
+    conn->out.push_back(response.release_body());
+    handle_requests(handle, conn);
+}
+
+void Server::flush(ConnectionHandle handle, Connection* conn) {
+    struct iovec iov[kMaxIov];
+    while (!conn->out.empty()) {
+        size_t count = std::min(conn->out.size(), kMaxIov);
+        for (size_t i = 0; i < count; i++) {
+            iov[i].iov_base = conn->out[i].data();
+            iov[i].iov_len = conn->out[i].size();
+        }
+        iov[0].iov_base = conn->out[0].data() + conn->out_offset;
+        iov[0].iov_len -= conn->out_offset;
+
+        ssize_t size =
+            conn->tls != nullptr
+                ? conn->tls->writev(iov, static_cast<int>(count))
+                : writev(conn->fd, iov, static_cast<int>(count));
+        BRICK_PROBE(send, conn->fd, size);
+        if (size < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                rearm(handle, conn, EPOLLOUT);
+                return;
+            }
+            if (errno == EINTR) continue;
+            remove_client(handle);
+            return;
+        }
+
+        // drop fully written chunks
+        size_t written = static_cast<size_t>(size) + conn->out_offset;
+        size_t done = 0;
+        while (done < count && written >= conn->out[done].size()) {
+            written -= conn->out[done].size();
+            done++;
+        }
+        conn->out.erase(conn->out.begin(), conn->out.begin() + done);
+        conn->out_offset = written;
+    }
+    conn->out_offset = 0;
+
+    if (conn->peer != kNoConnection) {
+        proxy_flushed(handle, conn);
+    } else if (conn->close_after) {
+        remove_client(handle);
+    } else {
+        rearm(handle, conn, EPOLLIN);
+    }
+}
+
+void Server::rearm(ConnectionHandle handle, Connection* conn,
+                   uint32_t events, int op) {
+    // a client waiting for its next request (or the rest of one) is left to
+    // the idle sweep, which closes it once it has waited too long
+    bool waiting = events == EPOLLIN && conn->out.empty() &&
+                   conn->peer == kNoConnection &&
+                   conn->proxy.upstream == nullptr;
+    bool between = waiting && conn->in.empty() &&
+                   (conn->tls == nullptr || conn->tls->handshake_done());
+    if (between && draining_) {
+        remove_client(handle);  // nothing in flight: done draining
+        return;
+    }
+    uint64_t generation = handle & ~0xFFFFFFFFULL;
+    uint64_t arming = generation | kIdleArming | (++conn->arms & ~kIdleArming);
+    if (waiting) {
+        // the wait for a request starts once the previous one is answered
+        // (and the handshake done), not at each part of it that arrives
+        if (between) {
+            conn->waiting_until = idle_deadline();
+        }
+        conn->idle.store(arming, std::memory_order_release);
+    }
+    uint64_t until = generation | (kIdleUntil + conn->waiting_until) |
+                     (between ? kIdleBetween : 0);
+
+    // TLS may have to write to make progress on a read (handshake, key
+    // updates), and plaintext already decrypted into OpenSSL's buffer never
+    // makes the socket readable again; waking on writability covers both
+    if (conn->tls != nullptr &&
+        (conn->tls->wants_write() || conn->tls->pending())) {
+        events |= EPOLLOUT;
+    }
+
+    struct epoll_event ev;
+    ev.events = events | EPOLLRDHUP | EPOLLONESHOT;
+    ev.data.u64 = handle;
+
+    if (epoll_ctl(epoll_fd(handle), op, conn->fd, &ev) < 0) {
+        remove_client(handle);
+        return;
+    }
+    // from here on, another worker may have the connection (and `conn` must
+    // not be touched); unless one already took it, it is now idle
+    if (waiting) {
+        conn->idle.compare_exchange_strong(arming, until,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed);
+    }
+}
+
+uint32_t Server::idle_deadline() const {
+    // (still below kIdleBetween once kIdleUntil is added)
+    constexpr uint32_t kNever = kIdleBetween - kIdleUntil - 1;
+    return keep_alive_timeout_.count() > 0
+               ? idle_clock() + keep_alive_timeout_.count()
+               : kNever;
+}
+
+void Server::close_idle() {
+    uint32_t now = idle_clock();
+    // once the successor has the listeners, clients between requests are
+    // closed right away: they would only keep this process from exiting
+    bool draining = draining_;
+    for (uint32_t index = 0; index < connections_->capacity(); index++) {
+        std::atomic<uint64_t>& idle = connections_->slot(index).idle;
+        uint64_t state = idle.load(std::memory_order_relaxed);
+        uint32_t code = state & 0xFFFFFFFF;
+        if (code < kIdleUntil || code >= kIdleArming) continue;
+        bool between = code & kIdleBetween;
+        if (!(draining && between) &&
+            (code & ~kIdleBetween) - kIdleUntil > now) {
+            continue;
+        }
+        // claiming it fails if a worker took it for an event meanwhile
+        uint64_t generation = state & ~0xFFFFFFFFULL;
+        if (idle.compare_exchange_strong(state, generation | kIdleExpired,
+                                         std::memory_order_acquire)) {
+            remove_client(generation | index);
+        }
+    }
+}
+
+void Server::hand_off() {
+    if (!handoff::send_listeners(handoff_fd_, listeners_, listen_fds_)) {
+        log::warning("Hot restart handoff failed, still serving");
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLONESHOT;
+        ev.data.u64 = kHandoffHandle;
+        epoll_ctl(shards_[0]->epoll_fd, EPOLL_CTL_MOD, handoff_fd_, &ev);
+        return;
+    }
 
-    // send response
-    if (send(client_fd, ans.c_str(), ans.size(), 0) < 0) {
+    // the successor owns accepts now. Our copies of the listeners stay open
+    // (they are closed in `cleanup`) so a racing `accept` can't hit a reused fd.
+    for (const auto& shard : shards_) {
+        for (int fd : listen_fds_) {
+            epoll_ctl(shard->epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        }
     }
+    epoll_ctl(shards_[0]->epoll_fd, EPOLL_CTL_DEL, handoff_fd_, nullptr);
+
+    drain_deadline_ = std::chrono::steady_clock::now() + kDrainTimeout;
+    draining_ = true;
+    log::info("Handed off ", listen_fds_.size(), " listeners, draining ",
+              active_connections_.load(), " connections");
+}
 
-    remove_client(client_fd);
+bool Server::drained() const {
+    return draining_ &&
+           (active_connections_ == 0 ||
+            std::chrono::steady_clock::now() >= drain_deadline_);
 }
 
-void Server::remove_client(int client_fd) const {
-    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, client_fd, nullptr);
-    shutdown(client_fd, SHUT_RDWR);
-    close(client_fd);
+void Server::log_access(const Connection* conn, const Request& request,
+                        unsigned int status, uint64_t bytes, uint8_t flags) {
+    if (access_log_ == nullptr) return;
+
+    access_log::Record record = {};
+    record.timestamp_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    record.request_id = conn->context.request_id();
+    memcpy(record.peer, &conn->remote_ip, sizeof(record.peer));
+    record.bytes = bytes;
+    record.latency_us = static_cast<uint32_t>(std::min<int64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - conn->context.start_time())
+            .count(),
+        UINT32_MAX));
+    record.status = static_cast<uint16_t>(status);
+    record.flags = flags;
+    if (conn->tls != nullptr) record.flags |= access_log::kTls;
+    if (conn->h2 != nullptr) record.flags |= access_log::kHttp2;
+
+    std::string method = request.method();
+    record.method = access_log::parse_method(method);
+    auto routes = route_ids_.find(method);
+    if (routes != route_ids_.end()) {
+        auto route = routes->second.find(request.route());
+        if (route != routes->second.end()) record.route = route->second;
+    }
+
+    access_log_->append(worker_index, record);
+}
+
+void Server::remove_client(ConnectionHandle handle) {
+    Connection* conn = connections_->get(handle);
+    if (conn == nullptr) return;
+
+    // unlink a proxied exchange, then deal with the other side once this
+    // connection is gone
+    ConnectionHandle peer = std::exchange(conn->peer, kNoConnection);
+    Connection* other =
+        peer != kNoConnection ? connections_->get(peer) : nullptr;
+    if (other != nullptr) {
+        other->peer = kNoConnection;
+    }
+    ProxyExchange& exchange = conn->proxy;
+    bool responding = exchange.responding;
+    bool closing = exchange.client_closing || exchange.body_left > 0;
+    if (exchange.upstream != nullptr) {
+        exchange.upstream->outstanding--;
+        if (other != nullptr) {
+            exchange.proxy->report(exchange.upstream, false);
+            // the client gets a 502, or a cut-off response
+            log_access(other, exchange.request,
+                       responding ? exchange.status : 502, exchange.relayed,
+                       access_log::kProxied |
+                           (responding ? access_log::kTruncated : 0));
+        }
+    }
+    bool upstream = exchange.upstream != nullptr;
+
+    epoll_ctl(epoll_fd(handle), EPOLL_CTL_DEL, conn->fd, nullptr);
+    if (conn->tls != nullptr) {
+        conn->tls->shutdown();
+    }
+    shutdown(conn->fd, SHUT_RDWR);
+    close(conn->fd);
+    connections_->release(handle);
+    active_connections_--;
+
+    if (other == nullptr) {
+        return;
+    }
+    if (upstream) {
+        fail_proxy(peer, responding, closing);
+    } else {
+        remove_client(peer);  // the client went away: drop its upstream
+    }
 }
 
-void Server::init(int port) {
-    init_listener(port);
+void Server::init() {
+    pipeline_ = Pipeline(std::move(middleware_));
+    middleware_.clear();
+    init_workers();
+    init_tls();
+    init_proxies();
+    init_access_log();
+
+    // inherited fds come back in the order of `listeners_`, so
+    // `listen_fds_[i]` is always `listeners_[i]`
+    if (!handoff_path_.empty() &&
+        !handoff::receive_listeners(handoff_path_, listeners_,
+                                    &listen_fds_)) {
+        log::fatal("Listeners differ from the running server's, not taking "
+                   "over from ", handoff_path_);
+        exit(1);
+    }
+
+    if (listen_fds_.empty()) {
+        for (const Listener& listener : listeners_) {
+            listen_fds_.push_back(init_listener(listener));
+            log::info("Listening on ", listener.describe());
+        }
+    } else {
+        log::info("Inherited ", listen_fds_.size(), " listeners from ",
+                  handoff_path_);
+    }
+
+    if (listen_fds_.empty()) {
+        log::fatal("No listeners configured");
+        exit(1);
+    }
+
     init_epoll();
+    init_handoff();
 }
 
-void Server::init_listener(int port) {
+int Server::init_listener(const Listener& listener) {
+    if (listener.kind == Listener::Kind::kTcp) {
+        return init_tcp_listener(listener);
+    }
+
     // create socket
-    // TODO(akhil): use nonblocking sockets instead
-    socket_fd_ = socket(AF_INET, SOCK_STREAM, 0);
-    if (socket_fd_ < 0) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
         exit(1);
     }
 
-    // set options
-    int opt = 1;
-    if (setsockopt(socket_fd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) <
-        0) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    // abstract names start with a NUL byte and are not NUL-terminated
+    size_t offset = listener.kind == Listener::Kind::kAbstract ? 1 : 0;
+    if (listener.address.size() + offset >= sizeof(addr.sun_path)) {
+        log::fatal("Unix socket address too long: ", listener.address);
         exit(1);
     }
-    opt = 1;
-    if (setsockopt(socket_fd_, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) <
-        0) {
+    memcpy(addr.sun_path + offset, listener.address.data(),
+           listener.address.size());
+    socklen_t addr_len = offsetof(struct sockaddr_un, sun_path) + offset +
+                         listener.address.size() + (offset == 0 ? 1 : 0);
+
+    // a stale socket file from a previous run would make bind fail
+    if (listener.kind == Listener::Kind::kUnix) {
+        unlink(listener.address.c_str());
+    }
+
+    // bind socket
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), addr_len) < 0) {
+        log::fatal("Could not bind ", listener.describe(), ": ",
+                   strerror(errno));
+        exit(1);
+    }
+
+    // listen
+    if (listen(fd, static_cast<int>(connections_->capacity())) < 0) {
         exit(1);
     }
 
+    return fd;
+}
+
+int Server::init_tcp_listener(const Listener& listener) {
     // get address info
     struct addrinfo hints, *res;  // NOLINT
     memset(&hints, 0, sizeof(hints));
-    hints.ai_family = AF_INET;
+    hints.ai_family = listener.address.empty() ? AF_INET : AF_UNSPEC;
     hints.ai_socktype = SOCK_STREAM;
     hints.ai_flags = AI_PASSIVE;
 
-    int status =
-        getaddrinfo(nullptr, std::to_string(port).c_str(), &hints, &res);
+    const char* host =
+        listener.address.empty() ? nullptr : listener.address.c_str();
+    int status = getaddrinfo(host, std::to_string(listener.port).c_str(),
+                             &hints, &res);
     if (status != 0) {
+        log::fatal("Could not resolve ", listener.describe(), ": ",
+                   gai_strerror(status));
+        exit(1);
+    }
+
+    // create socket
+    int fd = socket(res->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                    0);
+    if (fd < 0) {
         exit(1);
     }
 
+    // set options
+    int opt = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+        exit(1);
+    }
+    opt = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+        exit(1);
+    }
+    if (res->ai_family == AF_INET6) {
+        // "::" accepts IPv4 too (dual-stack); specific addresses are v6 only
+        opt = listener.address == "::" ? 0 : 1;
+        if (setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &opt, sizeof(opt)) < 0) {
+            exit(1);
+        }
+    }
+
+    apply_listener_options(fd);
+
     // bind socket
-    if (bind(socket_fd_, res->ai_addr, res->ai_addrlen) < 0) {
+    if (bind(fd, res->ai_addr, res->ai_addrlen) < 0) {
+        log::fatal("Could not bind ", listener.describe(), ": ",
+                   strerror(errno));
         exit(1);
     }
+    freeaddrinfo(res);
 
     // listen
-    if (listen(socket_fd_, kMaxConnections) < 0) {
+    if (listen(fd, static_cast<int>(connections_->capacity())) < 0) {
+        exit(1);
+    }
+
+    return fd;
+}
+
+void Server::apply_listener_options(int fd) const {
+    auto set = [fd](int level, int name, int value, const char* label) {
+        if (value != 0 &&
+            setsockopt(fd, level, name, &value, sizeof(value)) < 0) {
+            log::warning("Could not set ", label, ": ", strerror(errno));
+        }
+    };
+
+    set(IPPROTO_TCP, TCP_DEFER_ACCEPT, socket_options_.defer_accept_seconds,
+        "TCP_DEFER_ACCEPT");
+    set(IPPROTO_TCP, TCP_FASTOPEN, socket_options_.fastopen_queue,
+        "TCP_FASTOPEN");
+    set(SOL_SOCKET, SO_RCVBUF, socket_options_.receive_buffer, "SO_RCVBUF");
+    set(SOL_SOCKET, SO_SNDBUF, socket_options_.send_buffer, "SO_SNDBUF");
+}
+
+void Server::apply_client_options(int fd) const {
+    int opt = 1;
+    if (socket_options_.tcp_nodelay) {
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+    }
+    if (socket_options_.tcp_quickack) {
+        setsockopt(fd, IPPROTO_TCP, TCP_QUICKACK, &opt, sizeof(opt));
+    }
+    if (socket_options_.busy_poll_us != 0) {
+        setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &socket_options_.busy_poll_us,
+                   sizeof(socket_options_.busy_poll_us));
+    }
+}
+
+void Server::init_workers() {
+    std::vector<topology::Node> nodes;
+    if (worker_options_.numa_aware) {
+        nodes = topology::detect();
+    } else {
+        nodes.emplace_back();  // one shard, not pinned anywhere
+    }
+    // every shard needs a worker to serve the connections steered to it
+    nodes.resize(std::min<size_t>(nodes.size(),
+                                  std::max<size_t>(pool_.capacity(), 1)));
+
+    for (topology::Node& node : nodes) {
+        auto shard = std::make_unique<Shard>();
+        shard->node = node;
+        shard->workers = pool_.capacity() > 0 ? 1 : 0;
+        shards_.push_back(std::move(shard));
+    }
+    // the rest go where there are fewest workers per CPU
+    for (size_t i = shards_.size(); i < pool_.capacity(); i++) {
+        auto load = [](const std::unique_ptr<Shard>& shard) {
+            return static_cast<double>(shard->workers) /
+                   std::max<size_t>(shard->node.cpus.size(), 1);
+        };
+        auto next = std::min_element(
+            shards_.begin(), shards_.end(),
+            [&](const auto& a, const auto& b) { return load(a) < load(b); });
+        (*next)->workers++;
+    }
+
+    for (size_t i = 0; i < shards_.size(); i++) {
+        Shard& shard = *shards_[i];
+        shard.active = shard.workers;
+        for (int cpu : shard.node.cpus) {
+            if (cpu_shards_.size() <= static_cast<size_t>(cpu)) {
+                cpu_shards_.resize(cpu + 1, -1);
+            }
+            cpu_shards_[cpu] = static_cast<int>(i);
+        }
+        if (worker_options_.numa_aware) {
+            log::info("NUMA node ", shard.node.id, ": ", shard.workers,
+                      " workers on ", shard.node.cpus.size(), " CPUs");
+        }
+    }
+
+    // each shard's connections are allocated on its node
+    if (!worker_options_.numa_aware) nodes.clear();
+    connections_ = std::make_unique<ConnectionTable>(max_connections_, nodes);
+}
+
+void Server::init_tls() {
+    bool needed = std::any_of(listeners_.begin(), listeners_.end(),
+                              [](const Listener& l) { return l.tls; });
+    if (!needed) return;
+
+    if (tls_options_.certificate_file.empty()) {
+        log::fatal("TLS listener configured without enable_tls");
+        exit(1);
+    }
+    // proxied routes are only served over HTTP/1.1, so don't steer TLS
+    // clients to HTTP/2
+    if (!proxy_routes_.empty() && tls_options_.http2) {
+        log::info("Proxy routes configured, not offering HTTP/2 over TLS");
+        tls_options_.http2 = false;
+    }
+    tls_context_ = tls::Context::create(tls_options_);
+    if (tls_context_ == nullptr) {
+        exit(1);
+    }
+}
+
+void Server::init_proxies() {
+    for (auto& [method, routes] : proxy_routes_) {
+        for (auto& [route, proxy] : routes) {
+            if (!proxy->resolve()) {
+                exit(1);
+            }
+        }
+    }
+}
+
+void Server::init_access_log() {
+    if (access_log_options_.directory.empty()) return;
+
+    // every route, handled or proxied, gets an id; segments carry the table
+    std::vector<std::string> names;
+    for (const auto& [method, routes] : router_) {
+        for (const auto& [route, handler] : routes) {
+            names.push_back(method + " " + route);
+        }
+    }
+    for (const auto& [method, routes] : proxy_routes_) {
+        for (const auto& [route, proxy] : routes) {
+            names.push_back(method + " " + route);
+        }
+    }
+    std::sort(names.begin(), names.end());
+    for (size_t i = 0; i < names.size(); i++) {
+        size_t space = names[i].find(' ');
+        route_ids_[names[i].substr(0, space)][names[i].substr(space + 1)] =
+            static_cast<uint32_t>(i + 1);
+    }
+
+    access_log_ =
+        AccessLog::open(access_log_options_, pool_.capacity(), names);
+    if (access_log_ == nullptr) {
         exit(1);
     }
+    log::info("Writing access log to ", access_log_options_.directory);
 }
 
 void Server::init_epoll() {
-    epoll_fd_ = epoll_create1(0);
-    if (epoll_fd_ < 0) {
+    wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeup_fd_ < 0) {
+        exit(1);
+    }
+
+    for (const auto& shard : shards_) {
+        shard->epoll_fd = epoll_create1(0);
+        if (shard->epoll_fd < 0) {
+            exit(1);
+        }
+
+        // every shard accepts; with several, EPOLLEXCLUSIVE wakes only one
+        // of them per new connection, and `steer` sends it to its node
+        for (size_t i = 0; i < listen_fds_.size(); i++) {
+            struct epoll_event event;
+            event.events = EPOLLIN | EPOLLET;
+            if (shards_.size() > 1) event.events |= EPOLLEXCLUSIVE;
+            event.data.u64 = listener_handle(i);
+
+            if (epoll_ctl(shard->epoll_fd, EPOLL_CTL_ADD, listen_fds_[i],
+                          &event) < 0) {
+                exit(1);
+            }
+        }
+
+        // level-triggered and never read: once signalled, it wakes every
+        // worker, now and in any later `epoll_wait`
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.u64 = kWakeupHandle;
+        if (epoll_ctl(shard->epoll_fd, EPOLL_CTL_ADD, wakeup_fd_, &event) <
+            0) {
+            exit(1);
+        }
+    }
+}
+
+void Server::init_handoff() {
+    if (handoff_path_.empty()) return;
+
+    handoff_fd_ = handoff::listen_for_successor(handoff_path_);
+    if (handoff_fd_ < 0) {
         exit(1);
     }
 
+    // one-shot: exactly one worker performs the handoff
     struct epoll_event event;
-    event.events = EPOLLIN | EPOLLET;
-    event.data.fd = socket_fd_;
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.u64 = kHandoffHandle;
 
-    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, socket_fd_, &event) < 0) {
+    if (epoll_ctl(shards_[0]->epoll_fd, EPOLL_CTL_ADD, handoff_fd_, &event) <
+        0) {
         exit(1);
     }
 }
 
-void Server::block_signals() {
-    // threads should not receive SIGINT or SIGPIPE
+void Server::block_signals() const {
+    // threads should not receive SIGINT or SIGPIPE (or SIGUSR1, which asks
+    // the main thread for a trace dump)
     sigset_t set;
     sigemptyset(&set);
     sigaddset(&set, SIGINT);
     sigaddset(&set, SIGPIPE);
+    if (!trace_path_.empty()) {
+        sigaddset(&set, SIGUSR1);
+    }
     pthread_sigmask(SIG_BLOCK, &set, nullptr);
 }
 
+void Server::dump_trace() const {
+    long records = trace::dump(trace_path_);
+    if (records < 0) {
+        log::error("Could not write trace records to ", trace_path_);
+        return;
+    }
+    log::info("Wrote ", records, " trace records to ", trace_path_);
+}
+
 void Server::cleanup() {
+    eventfd_write(wakeup_fd_, 1);
+    for (const auto& shard : shards_) {
+        shard->unpark.release(shard->workers);
+    }
     for (std::thread& thread : pool_) {
         thread.join();
     }
-    shutdown(socket_fd_, SHUT_RDWR);
-    close(socket_fd_);
-    close(epoll_fd_);
+    // seals the workers' last segments
+    access_log_.reset();
+    // a handed-off listener is shared with the successor; shutting it down
+    // would stop the successor from accepting too
+    for (int fd : listen_fds_) {
+        if (!draining_) {
+            shutdown(fd, SHUT_RDWR);
+        }
+        close(fd);
+    }
+    if (!draining_) {
+        for (const Listener& listener : listeners_) {
+            if (listener.kind == Listener::Kind::kUnix) {
+                unlink(listener.address.c_str());
+            }
+        }
+    }
+    for (const auto& shard : shards_) {
+        close(shard->epoll_fd);
+    }
+    close(wakeup_fd_);
+
+    if (handoff_fd_ >= 0) {
+        close(handoff_fd_);
+        // after a handoff the path belongs to the successor
+        if (!draining_) unlink(handoff_path_.c_str());
+    }
 }
 
 // Constructor and Destructor
 
-Server::Server(unsigned int num_threads) {
+Server::Server(unsigned int num_threads, unsigned int max_connections)
+    : max_connections_(max_connections) {
     pool_.reserve(num_threads);
 }
 
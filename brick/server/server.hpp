@@ -1,13 +1,31 @@
 #pragma once
 
+#include <sys/epoll.h>
+
+#include <atomic>
+#include <chrono>
 #include <csignal>
 #include <functional>
+#include <memory>
+#include <optional>
+#include <semaphore>
 #include <string>
+#include <string_view>
 #include <thread>
+#include <utility>
 #include <vector>
 
+#include "brick/access_log/access_log.hpp"
 #include "brick/request/request.hpp"
 #include "brick/response/response.hpp"
+#include "brick/server/connection.hpp"
+#include "brick/server/listener.hpp"
+#include "brick/server/middleware.hpp"
+#include "brick/server/proxy.hpp"
+#include "brick/server/socket_options.hpp"
+#include "brick/server/topology.hpp"
+#include "brick/server/worker_options.hpp"
+#include "brick/tls/tls.hpp"
 
 namespace brick {
 
@@ -17,8 +35,19 @@ using Handler = std::function<Response(Request)>;
 
 class Server {
    public:
+    // default connection table size
+    static constexpr unsigned int kMaxConnections = 10000;
+    // default time a client may take to send its next request
+    static constexpr std::chrono::seconds kKeepAliveTimeout{60};
+
+    /**
+     * @brief Constructor for Server
+     * @param `num_threads` number of worker threads
+     * @param `max_connections` size of the preallocated connection table
+     */
     explicit Server(
-        unsigned int num_threads = std::thread::hardware_concurrency());
+        unsigned int num_threads = std::thread::hardware_concurrency(),
+        unsigned int max_connections = kMaxConnections);
     // ~Server();
     // delete copy, move, and copy assignment
     Server(const Server&) = delete;
@@ -27,32 +56,259 @@ class Server {
 
     void route(const std::string& path, const std::string& method,
                Handler handler);
+
+    /**
+     * @brief Forward requests for `path` to a reverse proxy's upstreams.
+     * Proxied routes are served over HTTP/1.1 only: HTTP/2 is then no longer
+     * offered over TLS, and h2c clients get 501 for them.
+     * @param `path` the route
+     * @param `method` the method
+     * @param `proxy` the upstreams to forward to (may be shared by routes)
+     */
+    void route(const std::string& path, const std::string& method,
+               std::shared_ptr<Proxy> proxy);
+
+    /**
+     * @brief Add middleware to run around every handler (call before `start`)
+     * @param `middleware` the middleware; runs after previously added ones
+     */
+    void use(Middleware middleware);
+
+    /**
+     * @brief Enable zero-downtime hot restarts
+     * @param `handoff_path` path of the Unix socket used to pass listening
+     * sockets between the old and new process. On `start`, the server first
+     * tries to inherit listeners from a server already bound to this path;
+     * that server then stops accepting and drains its open connections.
+     */
+    void enable_hot_restart(const std::string& handoff_path);
+
+    /**
+     * @brief Record per-request phase timings (see brick/utils/tracing) and
+     * write the latest ones to `dump_path` on SIGUSR1 (call before `start`)
+     * @param `dump_path` file the records are written to (replaced each time)
+     */
+    void enable_tracing(const std::string& dump_path);
+
+    /**
+     * @brief Write a binary access-log record for every request (call before
+     * `start`). Each worker appends to its own memory-mapped segment files;
+     * read them with tools/access_log_dump.
+     * @param `options` where and how to write the segments
+     */
+    void enable_access_log(const AccessLogOptions& options);
+
+    /**
+     * @brief Set socket tuning options (call before `start`)
+     * @param `options` the options to apply to listeners and client sockets
+     */
+    void set_socket_options(const SocketOptions& options);
+
+    /**
+     * @brief Set how long a client may take to send its next request (call
+     * before `start`). Connections that stay idle longer - between requests,
+     * or partway through one - are closed so they don't hold table slots.
+     * @param `timeout` the timeout, counted from the last response (or the
+     * accept); zero keeps idle connections open
+     */
+    void set_keep_alive_timeout(std::chrono::seconds timeout);
+
+    /**
+     * @brief Set worker placement and sizing options (call before `start`)
+     * @param `options` NUMA placement and adaptive pool sizing
+     */
+    void set_worker_options(const WorkerOptions& options);
+
+    /**
+     * @brief Accept TCP connections (call before `start`)
+     * @param `port` the port to listen on
+     * @param `host` address to bind: empty for all IPv4 interfaces, "::" for
+     * dual-stack IPv4 + IPv6, or a specific IPv4/IPv6 address or hostname
+     */
+    void listen_tcp(int port, const std::string& host = "");
+
+    /**
+     * @brief Configure TLS for `listen_tls` listeners (call before `start`)
+     * @param `options` certificate, key and protocol options
+     */
+    void enable_tls(const tls::TlsOptions& options);
+
+    /**
+     * @brief Accept TLS connections over TCP (call before `start`); requires
+     * `enable_tls`. HTTP/2 is negotiated through ALPN.
+     * @param `port` the port to listen on
+     * @param `host` address to bind, as for `listen_tcp`
+     */
+    void listen_tls(int port, const std::string& host = "");
+
+    /**
+     * @brief Accept connections on a Unix domain stream socket (call before
+     * `start`). Any existing file at `path` is replaced.
+     * @param `path` filesystem path of the socket
+     */
+    void listen_unix(const std::string& path);
+
+    /**
+     * @brief Accept connections on a Linux abstract-namespace Unix socket
+     * (call before `start`)
+     * @param `name` socket name, without the leading NUL byte
+     */
+    void listen_abstract(const std::string& name);
+
+    /**
+     * @brief Listen on `port` (in addition to any configured listeners) and
+     * serve until SIGINT
+     */
     void start(int port);
 
+    /**
+     * @brief Serve on the configured listeners until SIGINT
+     */
+    void start();
+
    private:
-    void init(int port);
-    void init_listener(int port);
+    // a NUMA node's share of the server (there is a single one unless
+    // `WorkerOptions::numa_aware`): the workers on the node, the epoll
+    // instance they wait on, and the connections registered with it, which
+    // live in the node's connection table partition
+    struct Shard {
+        topology::Node node;
+        int epoll_fd = -1;
+        unsigned int workers = 0;
+        // adaptive mode: workers waiting for events, and parked ones
+        std::atomic<unsigned int> active = 0;
+        std::atomic<unsigned int> parked = 0;
+        std::counting_semaphore<> unpark{0};
+    };
+
+    void init();
+    void init_workers();
+    int init_listener(const Listener& listener);
+    int init_tcp_listener(const Listener& listener);
+    void init_tls();
+    void init_proxies();
+    void init_access_log();
     void init_epoll();
-    static void block_signals();
+    void init_handoff();
+    void apply_listener_options(int fd) const;
+    void apply_client_options(int fd) const;
+    void block_signals() const;
+    void dump_trace() const;
 
-    void process_events();
-    void accept_connection() const;
-    void handle_request(int client_fd);
-    void remove_client(int client_fd) const;
+    void process_events(size_t shard);
+    void park(Shard& shard);
+    void unpark(Shard& shard);
+    void accept_connections(size_t listener);
+    size_t steer(int fd) const;
+    int epoll_fd(ConnectionHandle handle) const {
+        return shards_[connections_->partition(handle)]->epoll_fd;
+    }
+    void handle_event(ConnectionHandle handle, uint32_t events);
+    bool handshake(ConnectionHandle handle, Connection* conn);
+    bool read_requests(Connection* conn) const;
+    static size_t request_length(std::string_view in, bool* invalid);
+    static bool keep_alive(const Request& request);
+    void handle_requests(ConnectionHandle handle, Connection* conn);
+    static bool wants_h2c(const Request& request, std::string* settings);
+    void start_http2(Connection* conn);
+    void handle_http2(ConnectionHandle handle, Connection* conn);
+    void send_or_wait(ConnectionHandle handle, Connection* conn);
+    static size_t input_limit(const Connection* conn);
+    Response handle_request(Request& request, Context& context);
+    Response dispatch(const Request& request);
+    Proxy* find_proxy(std::string_view in) const;
+    bool start_proxy(ConnectionHandle handle, Connection* conn, Proxy& proxy);
+    void forward_body(ConnectionHandle handle, Connection* conn);
+    void handle_upstream(ConnectionHandle handle, Connection* conn);
+    void relay_response(ConnectionHandle handle, Connection* conn);
+    void proxy_flushed(ConnectionHandle handle, Connection* conn);
+    void finish_proxy(ConnectionHandle handle, Connection* conn, bool reuse);
+    void fail_proxy(ConnectionHandle client, bool responding, bool body_left);
+    void flush(ConnectionHandle handle, Connection* conn);
+    void rearm(ConnectionHandle handle, Connection* conn, uint32_t events,
+               int op = EPOLL_CTL_MOD);
+    uint32_t idle_deadline() const;
+    void close_idle();
+    void hand_off();
+    void log_access(const Connection* conn, const Request& request,
+                    unsigned int status, uint64_t bytes, uint8_t flags = 0);
+    void remove_client(ConnectionHandle handle);
+    bool drained() const;
     void cleanup();
 
-    // thread-safe on read...
-    static constexpr unsigned int kMaxConnections = 10000;
+    // events handled per `epoll_wait` (12 bytes each, fits in L1)
+    static constexpr int kEventBatch = 64;
+    // adaptive mode: a worker whose waits return within `kBusyGap` of its
+    // last batch is busy without a break, and once that has gone on for
+    // `kSaturatedTime` the node's active workers are falling behind
+    static constexpr std::chrono::microseconds kBusyGap{50};
+    static constexpr std::chrono::milliseconds kSaturatedTime{2};
+    // stack buffer for `recv`
+    static constexpr size_t kReadChunk = 4096;
+    // chunks per `writev` (two per pipelined response)
+    static constexpr size_t kMaxIov = 64;
+    // bytes read from one side of a proxied exchange before they are
+    // forwarded to the other
+    static constexpr size_t kProxyChunk = 64 * 1024;
+    // epoll handles that don't refer to a connection: the listener index
+    // goes where the generation would be
+    static constexpr ConnectionHandle listener_handle(size_t index) {
+        return (static_cast<uint64_t>(index) << 32) | ConnectionTable::kNoIndex;
+    }
+    static constexpr ConnectionHandle kHandoffHandle = ~0ULL;
+    // (a listener index that is never used)
+    static constexpr ConnectionHandle kWakeupHandle =
+        kHandoffHandle - (1ULL << 32);
+    // how long a replaced process waits for its in-flight exchanges to finish
+    static constexpr std::chrono::seconds kDrainTimeout{30};
 
     // std::unordered_map<std::string, std::function<Response(Request)>>
     // router_; map of path to method to handler
     std::unordered_map<Method, std::unordered_map<Route, Handler>> router_;
+    std::unordered_map<Method,
+                       std::unordered_map<Route, std::shared_ptr<Proxy>>>
+        proxy_routes_;
+
+    // middleware as registered, and flattened by `init`
+    std::vector<Middleware> middleware_;
+    Pipeline pipeline_;
 
     std::vector<std::thread> pool_;
-    int socket_fd_;
+    unsigned int max_connections_;
+    std::chrono::seconds keep_alive_timeout_ = kKeepAliveTimeout;
+    // created by `init_workers`, partitioned like `shards_`
+    std::unique_ptr<ConnectionTable> connections_;
+    WorkerOptions worker_options_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    // shard that serves connections arriving on each CPU (-1: none)
+    std::vector<int> cpu_shards_;
+    // registered with every shard's epoll; signalled to stop the workers
+    int wakeup_fd_ = -1;
+    SocketOptions socket_options_;
+    tls::TlsOptions tls_options_;
+    std::unique_ptr<tls::Context> tls_context_;
+    std::vector<Listener> listeners_;
+    std::vector<int> listen_fds_;
     int port_;
-    int epoll_fd_;
     volatile sig_atomic_t serving_ = 1;
+
+    // hot restart
+    std::string handoff_path_;
+    int handoff_fd_ = -1;
+    std::atomic<bool> draining_ = false;
+    std::atomic<int> active_connections_ = 0;
+    std::chrono::steady_clock::time_point drain_deadline_;
+
+    // phase timings are dumped here on SIGUSR1; empty when tracing is off
+    std::string trace_path_;
+
+    // access log (when enabled), and the route ids its records refer to
+    AccessLogOptions access_log_options_;
+    std::unique_ptr<AccessLog> access_log_;
+    std::unordered_map<Method, std::unordered_map<Route, uint32_t>>
+        route_ids_;
+    // hands out worker indices (the access log's per-worker segments)
+    std::atomic<size_t> next_worker_index_ = 0;
 };
 }  // namespace brick
 
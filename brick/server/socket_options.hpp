@@ -0,0 +1,50 @@
+#pragma once
+
+namespace brick {
+
+/**
+ * Socket tuning knobs, applied by `Server::start`. Every knob defaults to
+ * "leave the kernel default alone"; zero means unset for the numeric ones.
+ *
+ * Listener-level knobs (inherited by accepted sockets where the kernel
+ * supports it) are not re-applied to listeners inherited through a hot
+ * restart - the previous process already set them.
+ */
+struct SocketOptions {
+    /**
+     * TCP_NODELAY on client sockets: disable Nagle so small responses go out
+     * immediately (responses are already coalesced into one `writev`).
+     */
+    bool tcp_nodelay = false;
+
+    /**
+     * TCP_QUICKACK on client sockets, re-armed after every read since the
+     * kernel clears it: ACK requests immediately instead of delaying.
+     */
+    bool tcp_quickack = false;
+
+    /**
+     * TCP_DEFER_ACCEPT on the listener: only wake `accept` once the client has
+     * sent data, waiting at most this many seconds.
+     */
+    int defer_accept_seconds = 0;
+
+    /**
+     * TCP_FASTOPEN on the listener: length of the pending TFO request queue.
+     */
+    int fastopen_queue = 0;
+
+    /**
+     * SO_BUSY_POLL on client sockets: microseconds to busy-poll the device
+     * queue when reading, trading CPU for wakeup latency.
+     */
+    int busy_poll_us = 0;
+
+    /**
+     * SO_RCVBUF / SO_SNDBUF on the listener, in bytes.
+     */
+    int receive_buffer = 0;
+    int send_buffer = 0;
+};
+
+}  // namespace brick
@@ -0,0 +1,131 @@
+#include "topology.hpp"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace brick::topology {
+
+namespace {
+
+constexpr char kNodeDir[] = "/sys/devices/system/node";
+
+// CPUs the calling thread may run on
+std::vector<int> allowed_cpus() {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) < 0) return cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+// a sysfs cpulist: "0-3,8-11" (empty for memory-only nodes)
+std::vector<int> parse_cpulist(const std::string& text) {
+    std::vector<int> cpus;
+    const char* p = text.c_str();
+    while (*p >= '0' && *p <= '9') {
+        char* end;
+        long first = strtol(p, &end, 10);
+        long last = first;
+        if (*end == '-') {
+            last = strtol(end + 1, &end, 10);
+        }
+        for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+        p = *end == ',' ? end + 1 : end;
+    }
+    return cpus;
+}
+
+std::string read_file(const std::string& path) {
+    std::string text;
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return text;
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        text.append(buf, n);
+    }
+    close(fd);
+    return text;
+}
+
+void fill(const std::vector<int>& cpus, cpu_set_t* set) {
+    CPU_ZERO(set);
+    for (int cpu : cpus) {
+        CPU_SET(cpu, set);
+    }
+}
+
+}  // namespace
+
+std::vector<Node> detect() {
+    std::vector<int> allowed = allowed_cpus();
+    std::vector<Node> nodes;
+
+    DIR* dir = opendir(kNodeDir);
+    if (dir != nullptr) {
+        while (struct dirent* entry = readdir(dir)) {
+            const char* name = entry->d_name;
+            if (strncmp(name, "node", 4) != 0 || name[4] < '0' ||
+                name[4] > '9') {
+                continue;
+            }
+            Node node;
+            node.id = atoi(name + 4);
+            for (int cpu : parse_cpulist(read_file(
+                     std::string(kNodeDir) + "/" + name + "/cpulist"))) {
+                if (std::binary_search(allowed.begin(), allowed.end(), cpu)) {
+                    node.cpus.push_back(cpu);
+                }
+            }
+            // nodes we can't run on (or that have no CPUs) get no workers
+            if (!node.cpus.empty()) nodes.push_back(std::move(node));
+        }
+        closedir(dir);
+    }
+
+    if (nodes.empty()) {
+        nodes.push_back({0, std::move(allowed)});
+    }
+    std::sort(nodes.begin(), nodes.end(),
+              [](const Node& a, const Node& b) { return a.id < b.id; });
+    return nodes;
+}
+
+bool pin(const Node& node) {
+    cpu_set_t set;
+    fill(node.cpus, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+void run_on(const Node& node, const std::function<void()>& fn) {
+    cpu_set_t saved;
+    bool moved = sched_getaffinity(0, sizeof(saved), &saved) == 0 && pin(node);
+    fn();
+    if (moved) {
+        sched_setaffinity(0, sizeof(saved), &saved);
+    }
+}
+
+int incoming_cpu(int fd) {
+    int cpu = -1;
+    socklen_t len = sizeof(cpu);
+    if (getsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) < 0) {
+        return -1;
+    }
+    return cpu;
+}
+
+}  // namespace brick::topology
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+/**
+ * CPU topology for NUMA-aware worker placement, read from sysfs
+ * (/sys/devices/system/node) - no libnuma needed.
+ *
+ * Memory is placed by the kernel's default first-touch policy: a page is
+ * allocated on the node of the CPU that first writes it. Running a thread on
+ * a node's CPUs while it initializes memory is therefore enough to make that
+ * memory node-local.
+ */
+
+namespace brick::topology {
+
+struct Node {
+    int id = 0;
+    // CPUs of the node this process may run on
+    std::vector<int> cpus;
+};
+
+/**
+ * @brief Find the NUMA nodes this process can run on
+ * @return the nodes that have allowed CPUs, by id; a single node 0 holding
+ * every allowed CPU when the machine (or sysfs) doesn't report NUMA nodes
+ */
+std::vector<Node> detect();
+
+/**
+ * @brief Restrict the calling thread to a node's CPUs
+ * @return false if the affinity could not be set
+ */
+bool pin(const Node& node);
+
+/**
+ * @brief Run `fn` on `node`'s CPUs, so the memory it touches first is
+ * allocated on the node, then restore the calling thread's affinity
+ */
+void run_on(const Node& node, const std::function<void()>& fn);
+
+/**
+ * @brief Get the CPU that last processed a socket's incoming packets
+ * (SO_INCOMING_CPU): for a freshly accepted connection, the CPU serving the
+ * NIC queue it arrived on
+ * @return the CPU, or -1 if unknown (e.g. Unix sockets)
+ */
+int incoming_cpu(int fd);
+
+}  // namespace brick::topology
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <chrono>
+
+namespace brick {
+
+/**
+ * Worker pool placement and sizing, applied by `Server::start`. The defaults
+ * keep a plain pool: every worker may run on any CPU and always waits for
+ * events.
+ */
+struct WorkerOptions {
+    /**
+     * Split the server by NUMA node: workers are spread over the nodes in
+     * proportion to their CPUs and pinned to them, each node's share of the
+     * connection table is allocated on the node, and every new connection is
+     * handed to the workers of the node whose CPU received its packets
+     * (SO_INCOMING_CPU), i.e. the node of its NIC queue.
+     */
+    bool numa_aware = false;
+
+    /**
+     * Scale the number of active workers to load. A worker that gets no
+     * events for `idle_timeout` parks - it sleeps without polling - until a
+     * worker on its node is saturated and wakes it. `min_workers` workers
+     * per node (at least one) never park.
+     *
+     * A worker counts as saturated when a wait fills its whole event batch
+     * (so more events are likely still pending), or when it has been
+     * handling events without a break for a couple of milliseconds: each
+     * wait returned at once, or one slow handler held it. The second case
+     * catches a few connections with slow handlers, which never produce
+     * large batches.
+     */
+    bool adaptive = false;
+    unsigned int min_workers = 1;
+    std::chrono::milliseconds idle_timeout{2000};
+};
+
+}  // namespace brick
@@ -0,0 +1,309 @@
+#include "tls.hpp"
+
+#include <openssl/core_names.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/ssl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+
+#include "brick/utils/logging/logger.hpp"
+
+namespace brick::tls {
+
+struct TicketKeys {
+    struct Key {
+        unsigned char name[16];
+        unsigned char aes[32];
+        unsigned char hmac[32];
+    };
+
+    /**
+     * @brief Replace the current key once it has been in use for `lifetime`
+     * (call with `mutex` held)
+     * @return false if no new key could be generated
+     */
+    bool rotate() {
+        auto now = std::chrono::steady_clock::now();
+        if (generated && (lifetime.count() == 0 || now < rotated + lifetime)) {
+            return true;
+        }
+        Key next;
+        if (RAND_bytes(reinterpret_cast<unsigned char*>(&next),
+                       sizeof(next)) != 1) {
+            return false;
+        }
+        // tickets under the outgoing key stay good for one more lifetime,
+        // unless that has passed too (no handshakes in the meantime)
+        previous = current;
+        has_previous = generated && now < rotated + 2 * lifetime;
+        current = next;
+        OPENSSL_cleanse(&next, sizeof(next));
+        generated = true;
+        rotated = now;
+        return true;
+    }
+
+    std::chrono::seconds lifetime{0};
+    // every worker issues and checks tickets
+    std::mutex mutex;
+    // new tickets are issued under `current`
+    Key current = {};
+    Key previous = {};
+    bool generated = false;
+    bool has_previous = false;
+    std::chrono::steady_clock::time_point rotated;
+};
+
+namespace {
+
+// largest plaintext handed to one userspace `SSL_write` (four full records)
+constexpr size_t kMaxWriteBatch = 4 * 16384;
+
+// ALPN protocol lists, in wire format (length-prefixed)
+constexpr unsigned char kAlpnHttp2[] = "\x02h2\x08http/1.1";
+constexpr unsigned char kAlpnHttp1[] = "\x08http/1.1";
+
+std::string last_error() {
+    char buf[256];
+    ERR_error_string_n(ERR_get_error(), buf, sizeof(buf));
+    return buf;
+}
+
+int select_alpn(SSL*, const unsigned char** out, unsigned char* out_len,
+                const unsigned char* in, unsigned int in_len, void* arg) {
+    bool http2 = arg != nullptr;
+    const unsigned char* server = http2 ? kAlpnHttp2 : kAlpnHttp1;
+    unsigned int server_len =
+        http2 ? sizeof(kAlpnHttp2) - 1 : sizeof(kAlpnHttp1) - 1;
+
+    unsigned char* selected;
+    if (SSL_select_next_proto(&selected, out_len, server, server_len, in,
+                              in_len) != OPENSSL_NPN_NEGOTIATED) {
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+    *out = selected;
+    return SSL_TLSEXT_ERR_OK;
+}
+
+// OpenSSL's own ticket key is made once per context and never changes, so
+// tickets go through our rotating keys instead. Returns 1 to use the key, 2
+// to accept a ticket but issue a fresh one, 0 for an unknown key (a full
+// handshake follows) and -1 on error.
+int ticket_key(SSL* ssl, unsigned char key_name[16], unsigned char* iv,
+               EVP_CIPHER_CTX* cipher, EVP_MAC_CTX* mac, int encrypt) {
+    auto* keys =
+        static_cast<TicketKeys*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+    TicketKeys::Key key;
+    int found = 1;
+    {
+        std::lock_guard<std::mutex> lock(keys->mutex);
+        if (!keys->rotate()) return -1;
+        if (encrypt ||
+            memcmp(key_name, keys->current.name, sizeof(key.name)) == 0) {
+            key = keys->current;
+        } else if (keys->has_previous &&
+                   memcmp(key_name, keys->previous.name, sizeof(key.name)) ==
+                       0) {
+            key = keys->previous;
+            found = 2;
+        } else {
+            return 0;
+        }
+    }
+
+    if (encrypt) {
+        memcpy(key_name, key.name, sizeof(key.name));
+        if (RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_256_cbc())) != 1) {
+            found = -1;
+        }
+    }
+    char digest[] = "SHA256";
+    OSSL_PARAM params[] = {
+        OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, key.hmac,
+                                          sizeof(key.hmac)),
+        OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, digest, 0),
+        OSSL_PARAM_construct_end()};
+    if (found > 0 &&
+        (EVP_MAC_CTX_set_params(mac, params) != 1 ||
+         EVP_CipherInit_ex(cipher, EVP_aes_256_cbc(), nullptr, key.aes, iv,
+                           encrypt) != 1)) {
+        found = -1;
+    }
+    OPENSSL_cleanse(&key, sizeof(key));
+    return found;
+}
+
+}  // namespace
+
+// ** Context **
+
+std::unique_ptr<Context> Context::create(const TlsOptions& options) {
+    SSL_CTX* ctx = SSL_CTX_new(TLS_server_method());
+    if (ctx == nullptr) {
+        log::error("Could not create TLS context: ", last_error());
+        return nullptr;
+    }
+    std::unique_ptr<Context> context(new Context(ctx));
+
+    SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+    uint64_t ssl_options =
+        SSL_OP_NO_RENEGOTIATION | SSL_OP_CIPHER_SERVER_PREFERENCE;
+    if (options.ktls) ssl_options |= SSL_OP_ENABLE_KTLS;
+    SSL_CTX_set_options(ctx, ssl_options);
+
+    // writes are retried from a rebuilt buffer after EAGAIN, and may be
+    // accepted partially like a plain `writev`
+    SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE |
+                              SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER |
+                              SSL_MODE_RELEASE_BUFFERS);
+
+    if (SSL_CTX_use_certificate_chain_file(
+            ctx, options.certificate_file.c_str()) != 1 ||
+        SSL_CTX_use_PrivateKey_file(ctx, options.private_key_file.c_str(),
+                                    SSL_FILETYPE_PEM) != 1 ||
+        SSL_CTX_check_private_key(ctx) != 1) {
+        log::error("Could not load TLS certificate ", options.certificate_file,
+                   ": ", last_error());
+        return nullptr;
+    }
+
+    // resumption: server-side session cache (session ids) plus tickets
+    static constexpr unsigned char kSessionIdContext[] = "brick";
+    SSL_CTX_set_session_id_context(ctx, kSessionIdContext,
+                                   sizeof(kSessionIdContext) - 1);
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+    SSL_CTX_sess_set_cache_size(ctx, options.session_cache_size);
+    TicketKeys& keys = *context->ticket_keys_;
+    keys.lifetime = std::chrono::seconds(options.ticket_key_lifetime_seconds);
+    if (!keys.rotate()) {
+        log::error("Could not generate a TLS ticket key: ", last_error());
+        return nullptr;
+    }
+    SSL_CTX_set_app_data(ctx, &keys);
+    SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx, ticket_key);
+
+    SSL_CTX_set_alpn_select_cb(ctx, select_alpn,
+                               options.http2 ? context.get() : nullptr);
+
+    return context;
+}
+
+Context::Context(SSL_CTX* ctx)
+    : ctx_(ctx), ticket_keys_(std::make_unique<TicketKeys>()) {}
+
+Context::~Context() { SSL_CTX_free(ctx_); }
+
+// ** Channel **
+
+std::unique_ptr<Channel> Channel::create(const Context& context, int fd) {
+    SSL* ssl = SSL_new(context.get());
+    if (ssl == nullptr) {
+        log::error("Could not create TLS connection: ", last_error());
+        return nullptr;
+    }
+    std::unique_ptr<Channel> channel(new Channel(ssl, fd));
+    if (SSL_set_fd(ssl, fd) != 1) {
+        log::error("Could not attach TLS connection: ", last_error());
+        return nullptr;
+    }
+    SSL_set_accept_state(ssl);
+    return channel;
+}
+
+Channel::~Channel() { SSL_free(ssl_); }
+
+int Channel::handshake() {
+    ERR_clear_error();
+    int ret = SSL_do_handshake(ssl_);
+    if (ret == 1) {
+        handshake_done_ = true;
+        wants_write_ = false;
+        ktls_send_ = BIO_get_ktls_send(SSL_get_wbio(ssl_)) != 0;
+        return 1;
+    }
+
+    switch (SSL_get_error(ssl_, ret)) {
+        case SSL_ERROR_WANT_READ:
+            wants_write_ = false;
+            return 0;
+        case SSL_ERROR_WANT_WRITE:
+            wants_write_ = true;
+            return 0;
+        default:
+            log::debug("TLS handshake failed: ", last_error());
+            return -1;
+    }
+}
+
+ssize_t Channel::read(char* buf, size_t len) {
+    ERR_clear_error();
+    int ret = SSL_read(ssl_, buf, static_cast<int>(len));
+    return ret > 0 ? ret : result(ret);
+}
+
+ssize_t Channel::writev(const struct iovec* iov, int count) {
+    // the kernel encrypts: write the caller's buffers directly
+    if (ktls_send_) {
+        return ::writev(fd_, iov, count);
+    }
+
+    // gather into one `SSL_write` so small chunks share records. A retry
+    // after EAGAIN rebuilds the same bytes from the same iovec.
+    scratch_.clear();
+    for (int i = 0; i < count && scratch_.size() < kMaxWriteBatch; i++) {
+        size_t take = std::min(iov[i].iov_len, kMaxWriteBatch - scratch_.size());
+        scratch_.append(static_cast<const char*>(iov[i].iov_base), take);
+    }
+    if (scratch_.empty()) return 0;
+
+    ERR_clear_error();
+    int ret =
+        SSL_write(ssl_, scratch_.data(), static_cast<int>(scratch_.size()));
+    return ret > 0 ? ret : result(ret);
+}
+
+ssize_t Channel::result(int ret) {
+    switch (SSL_get_error(ssl_, ret)) {
+        case SSL_ERROR_WANT_READ:
+            wants_write_ = false;
+            errno = EAGAIN;
+            return -1;
+        case SSL_ERROR_WANT_WRITE:
+            wants_write_ = true;
+            errno = EAGAIN;
+            return -1;
+        case SSL_ERROR_ZERO_RETURN:
+            return 0;  // close_notify
+        case SSL_ERROR_SYSCALL:
+            if (errno == 0) return 0;  // EOF without close_notify
+            return -1;
+        default:
+            errno = ECONNRESET;
+            return -1;
+    }
+}
+
+bool Channel::pending() const { return SSL_has_pending(ssl_) == 1; }
+
+std::string Channel::alpn() const {
+    const unsigned char* data;
+    unsigned int len;
+    SSL_get0_alpn_selected(ssl_, &data, &len);
+    return {reinterpret_cast<const char*>(data), len};
+}
+
+void Channel::shutdown() {
+    if (handshake_done_) {
+        ERR_clear_error();
+        SSL_shutdown(ssl_);
+    }
+}
+
+}  // namespace brick::tls
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+// OpenSSL types, so users of this header don't need OpenSSL's
+typedef struct ssl_ctx_st SSL_CTX;
+typedef struct ssl_st SSL;
+
+/**
+ * TLS termination on top of non-blocking sockets (OpenSSL).
+ *
+ * Handshakes are driven from the epoll loop: every call may report that it
+ * needs the socket to become readable or writable, and is simply retried on
+ * the next event. Once the handshake is done, record encryption is handed to
+ * the kernel (kTLS) when both OpenSSL and the kernel support it; writes then
+ * go straight to `writev` on the socket with no userspace copy or
+ * encryption. Otherwise records are encrypted in userspace.
+ */
+
+namespace brick::tls {
+
+// the rotating session ticket keys of a `Context`
+struct TicketKeys;
+
+struct TlsOptions {
+    // PEM certificate chain and private key
+    std::string certificate_file;
+    std::string private_key_file;
+
+    // offload record encryption to the kernel when available
+    bool ktls = true;
+
+    // server-side session cache entries (session-id resumption); session
+    // tickets are always enabled
+    long session_cache_size = 20480;
+
+    // seconds before the session ticket key is replaced (0: never). Tickets
+    // under the previous key are still accepted, and renewed.
+    long ticket_key_lifetime_seconds = 12 * 3600;
+
+    // offer HTTP/2 through ALPN
+    bool http2 = true;
+
+    // seconds a client gets to complete its handshake, counted from the
+    // accept; clients that take longer are disconnected
+    int handshake_timeout_seconds = 10;
+};
+
+/**
+ * @brief Shared TLS configuration (certificate, session cache, ticket keys);
+ * one per server, used by every worker thread
+ */
+class Context {
+   public:
+    /**
+     * @brief Load certificates and build the context
+     * @return the context, or nullptr on failure (errors are logged)
+     */
+    static std::unique_ptr<Context> create(const TlsOptions& options);
+
+    ~Context();
+    Context(const Context&) = delete;
+    Context& operator=(const Context&) = delete;
+
+    SSL_CTX* get() const { return ctx_; }
+
+   private:
+    explicit Context(SSL_CTX* ctx);
+
+    SSL_CTX* ctx_;
+    std::unique_ptr<TicketKeys> ticket_keys_;
+};
+
+/**
+ * @brief TLS state of one client connection. Like the rest of a connection's
+ * state, it is only touched by the worker that owns the connection.
+ *
+ * `read` and `writev` follow the socket conventions: -1 with errno EAGAIN
+ * when the operation has to wait for the socket, 0 from `read` on a clean
+ * close.
+ */
+class Channel {
+   public:
+    /**
+     * @brief Start the server side of a TLS connection on `fd`
+     * @return the channel, or nullptr on failure (errors are logged)
+     */
+    static std::unique_ptr<Channel> create(const Context& context, int fd);
+
+    ~Channel();
+    Channel(const Channel&) = delete;
+    Channel& operator=(const Channel&) = delete;
+
+    /**
+     * @brief Advance the handshake
+     * @return 1 when done, 0 to wait for the socket, -1 on failure
+     */
+    int handshake();
+
+    bool handshake_done() const { return handshake_done_; }
+
+    ssize_t read(char* buf, size_t len);
+    ssize_t writev(const struct iovec* iov, int count);
+
+    /**
+     * @brief Whether the last operation is waiting for the socket to become
+     * writable (rather than readable)
+     */
+    bool wants_write() const { return wants_write_; }
+
+    /**
+     * @brief Whether decrypted data is buffered inside OpenSSL; the socket
+     * will not report it as readable
+     */
+    bool pending() const;
+
+    /**
+     * @brief Whether records are encrypted by the kernel (kTLS)
+     */
+    bool ktls_send() const { return ktls_send_; }
+
+    /**
+     * @brief The protocol selected through ALPN ("h2", "http/1.1" or empty)
+     */
+    std::string alpn() const;
+
+    /**
+     * @brief Send close_notify (best effort)
+     */
+    void shutdown();
+
+   private:
+    Channel(SSL* ssl, int fd) : ssl_(ssl), fd_(fd) {}
+
+    ssize_t result(int ret);
+
+    SSL* ssl_;
+    int fd_;
+    bool handshake_done_ = false;
+    bool wants_write_ = false;
+    bool ktls_send_ = false;
+    // plaintext gathered from an iovec for one userspace `SSL_write`
+    std::string scratch_;
+};
+
+}  // namespace brick::tls
@@ -0,0 +1,255 @@
+#include "brick/tls/tls.hpp"
+
+#include <gtest/gtest.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+namespace brick::tls {
+namespace {
+
+// a self-signed P-256 certificate and its key, as PEM files in a fresh
+// temporary directory
+class Certificate {
+   public:
+    Certificate() {
+        char dir[] = "/tmp/brick_tls_test.XXXXXX";
+        EXPECT_NE(mkdtemp(dir), nullptr);
+        dir_ = dir;
+        certificate_file_ = dir_ + "/cert.pem";
+        private_key_file_ = dir_ + "/key.pem";
+
+        EVP_PKEY* key = EVP_EC_gen("P-256");
+        X509* cert = X509_new();
+        ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+        X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+        X509_gmtime_adj(X509_getm_notAfter(cert), 24 * 3600);
+        X509_set_pubkey(cert, key);
+        X509_NAME* name = X509_get_subject_name(cert);
+        X509_NAME_add_entry_by_txt(
+            name, "CN", MBSTRING_ASC,
+            reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+        X509_set_issuer_name(cert, name);
+        EXPECT_GT(X509_sign(cert, key, EVP_sha256()), 0);
+
+        FILE* file = fopen(certificate_file_.c_str(), "w");
+        PEM_write_X509(file, cert);
+        fclose(file);
+        file = fopen(private_key_file_.c_str(), "w");
+        PEM_write_PrivateKey(file, key, nullptr, nullptr, 0, nullptr,
+                             nullptr);
+        fclose(file);
+        X509_free(cert);
+        EVP_PKEY_free(key);
+    }
+
+    ~Certificate() {
+        unlink(certificate_file_.c_str());
+        unlink(private_key_file_.c_str());
+        rmdir(dir_.c_str());
+    }
+
+    TlsOptions options() const {
+        TlsOptions options;
+        options.certificate_file = certificate_file_;
+        options.private_key_file = private_key_file_;
+        // (socketpairs can't do kTLS anyway)
+        options.ktls = false;
+        return options;
+    }
+
+   private:
+    std::string dir_;
+    std::string certificate_file_;
+    std::string private_key_file_;
+};
+
+// a client over a non-blocking socketpair, driven in lockstep with the
+// server's `Channel`
+class Client {
+   public:
+    // `alpn` in wire format, empty to offer none
+    Client(const Context& context, const std::string& alpn,
+           SSL_SESSION* session = nullptr)
+        : ctx_(SSL_CTX_new(TLS_client_method())) {
+        EXPECT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds_),
+                  0);
+        channel_ = Channel::create(context, fds_[0]);
+        EXPECT_NE(channel_, nullptr);
+
+        ssl_ = SSL_new(ctx_);
+        SSL_set_fd(ssl_, fds_[1]);
+        if (!alpn.empty()) {
+            SSL_set_alpn_protos(
+                ssl_, reinterpret_cast<const unsigned char*>(alpn.data()),
+                alpn.size());
+        }
+        if (session != nullptr) SSL_set_session(ssl_, session);
+        SSL_set_connect_state(ssl_);
+    }
+
+    ~Client() {
+        // (without close_notify, OpenSSL marks the session not resumable)
+        SSL_shutdown(ssl_);
+        SSL_free(ssl_);
+        SSL_CTX_free(ctx_);
+        close(fds_[0]);
+        close(fds_[1]);
+    }
+
+    // run both sides of the handshake; false if the server's failed
+    bool handshake() {
+        for (int round = 0; round < 100; round++) {
+            int server = channel_->handshake();
+            if (server < 0) return false;
+            bool client = SSL_do_handshake(ssl_) == 1;
+            if (server == 1 && client) return true;
+        }
+        ADD_FAILURE() << "handshake did not finish";
+        return false;
+    }
+
+    // send from the client, read on the server
+    std::string to_server(const std::string& data) {
+        EXPECT_EQ(SSL_write(ssl_, data.data(), static_cast<int>(data.size())),
+                  static_cast<int>(data.size()));
+        char buf[256];
+        ssize_t size = channel_->read(buf, sizeof(buf));
+        return size > 0 ? std::string(buf, size) : "";
+    }
+
+    // send from the server, read on the client
+    std::string to_client(const std::string& data) {
+        struct iovec iov[2] = {
+            {const_cast<char*>(data.data()), data.size() / 2},
+            {const_cast<char*>(data.data()) + data.size() / 2,
+             data.size() - data.size() / 2}};
+        EXPECT_EQ(channel_->writev(iov, 2), static_cast<ssize_t>(data.size()));
+        char buf[256];
+        int size = SSL_read(ssl_, buf, sizeof(buf));
+        return size > 0 ? std::string(buf, size) : "";
+    }
+
+    Channel& channel() { return *channel_; }
+    SSL* ssl() { return ssl_; }
+    int client_fd() const { return fds_[1]; }
+
+   private:
+    int fds_[2];
+    std::unique_ptr<Channel> channel_;
+    SSL_CTX* ctx_;
+    SSL* ssl_;
+};
+
+const std::string kOfferHttp2("\x02h2\x08http/1.1", 12);
+const std::string kOfferHttp1("\x08http/1.1", 9);
+
+class TlsTest : public ::testing::Test {
+   protected:
+    Certificate certificate_;
+};
+
+TEST_F(TlsTest, HandshakesAndExchangesData) {
+    auto context = Context::create(certificate_.options());
+    ASSERT_NE(context, nullptr);
+    Client client(*context, kOfferHttp1);
+    EXPECT_FALSE(client.channel().handshake_done());
+    ASSERT_TRUE(client.handshake());
+    EXPECT_TRUE(client.channel().handshake_done());
+    EXPECT_FALSE(client.channel().ktls_send());
+
+    EXPECT_EQ(client.to_server("GET / HTTP/1.1\r\n\r\n"),
+              "GET / HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(client.to_client("HTTP/1.1 200 OK\r\n\r\n"),
+              "HTTP/1.1 200 OK\r\n\r\n");
+
+    // nothing more to read: the socket convention for "try again later"
+    char buf[16];
+    EXPECT_EQ(client.channel().read(buf, sizeof(buf)), -1);
+    EXPECT_EQ(errno, EAGAIN);
+}
+
+TEST_F(TlsTest, NegotiatesAlpn) {
+    auto context = Context::create(certificate_.options());
+    ASSERT_NE(context, nullptr);
+    {
+        Client client(*context, kOfferHttp2);
+        ASSERT_TRUE(client.handshake());
+        EXPECT_EQ(client.channel().alpn(), "h2");
+    }
+    {
+        Client client(*context, kOfferHttp1);
+        ASSERT_TRUE(client.handshake());
+        EXPECT_EQ(client.channel().alpn(), "http/1.1");
+    }
+    {
+        Client client(*context, "");
+        ASSERT_TRUE(client.handshake());
+        EXPECT_EQ(client.channel().alpn(), "");
+    }
+}
+
+TEST_F(TlsTest, OffersOnlyHttp1WithoutHttp2) {
+    TlsOptions options = certificate_.options();
+    options.http2 = false;
+    auto context = Context::create(options);
+    ASSERT_NE(context, nullptr);
+    Client client(*context, kOfferHttp2);
+    ASSERT_TRUE(client.handshake());
+    EXPECT_EQ(client.channel().alpn(), "http/1.1");
+}
+
+TEST_F(TlsTest, ResumesWithTicket) {
+    auto context = Context::create(certificate_.options());
+    ASSERT_NE(context, nullptr);
+    SSL_SESSION* session;
+    {
+        Client client(*context, kOfferHttp1);
+        ASSERT_TRUE(client.handshake());
+        // TLS 1.3 tickets arrive after the handshake
+        EXPECT_EQ(client.to_client("x"), "x");
+        session = SSL_get1_session(client.ssl());
+        ASSERT_NE(session, nullptr);
+        EXPECT_EQ(SSL_SESSION_has_ticket(session), 1);
+    }
+    {
+        Client client(*context, kOfferHttp1, session);
+        ASSERT_TRUE(client.handshake());
+        EXPECT_EQ(SSL_session_reused(client.ssl()), 1);
+    }
+    // another server's tickets are not accepted
+    auto other = Context::create(certificate_.options());
+    ASSERT_NE(other, nullptr);
+    {
+        Client client(*other, kOfferHttp1, session);
+        ASSERT_TRUE(client.handshake());
+        EXPECT_EQ(SSL_session_reused(client.ssl()), 0);
+    }
+    SSL_SESSION_free(session);
+}
+
+TEST_F(TlsTest, FailsOnGarbage) {
+    auto context = Context::create(certificate_.options());
+    ASSERT_NE(context, nullptr);
+    Client client(*context, "");
+    ASSERT_EQ(write(client.client_fd(), "GET / HTTP/1.1\r\n\r\n", 18), 18);
+    EXPECT_EQ(client.channel().handshake(), -1);
+}
+
+TEST(TlsContextTest, RejectsMissingCertificate) {
+    TlsOptions options;
+    options.certificate_file = "/nonexistent/cert.pem";
+    options.private_key_file = "/nonexistent/key.pem";
+    EXPECT_EQ(Context::create(options), nullptr);
+}
+
+}  // namespace
+}  // namespace brick::tls
@@ -0,0 +1,187 @@
+#include "tracing.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace brick::trace {
+
+bool active = false;
+
+namespace {
+
+// records kept per worker (power of two)
+constexpr size_t kRingSize = 4096;
+// finished records per event (pipelined requests) before an early commit
+constexpr size_t kMaxPending = 64;
+
+struct Record {
+    uint64_t request_id;
+    uint64_t stamps[kPhaseCount];
+};
+
+// seqlock: the version is odd while the owning worker rewrites the record,
+// so `dump` can skip torn reads without ever blocking the worker
+struct Slot {
+    std::atomic<uint32_t> version = 0;
+    Record record;
+};
+
+struct Ring {
+    std::unique_ptr<Slot[]> slots = std::make_unique<Slot[]>(kRingSize);
+    // next slot to write; only touched by the owning worker
+    uint64_t head = 0;
+};
+
+struct ThreadState {
+    Ring* ring = nullptr;
+    uint64_t wakeup = 0;
+    uint64_t read = 0;
+    Record current = {};
+    Record pending[kMaxPending];
+    size_t pending_count = 0;
+};
+
+// rings are owned here, not by their threads, so they can be dumped after
+// the workers exit
+std::mutex rings_mutex;
+std::vector<std::unique_ptr<Ring>> rings;
+
+// reference point for converting ticks to nanoseconds
+uint64_t base_ticks = 0;
+int64_t base_ns = 0;
+
+int64_t steady_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+ThreadState& state() {
+    thread_local std::unique_ptr<ThreadState> state;
+    if (state == nullptr) {
+        state = std::make_unique<ThreadState>();
+        auto ring = std::make_unique<Ring>();
+        state->ring = ring.get();
+
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        rings.push_back(std::move(ring));
+    }
+    return *state;
+}
+
+double ns_per_tick() {
+    uint64_t now_ticks = ticks();
+    int64_t now_ns = steady_ns();
+    if (now_ticks <= base_ticks || now_ns <= base_ns) return 1;
+    return static_cast<double>(now_ns - base_ns) /
+           static_cast<double>(now_ticks - base_ticks);
+}
+
+}  // namespace
+
+void enable() {
+    base_ticks = ticks();
+    base_ns = steady_ns();
+    active = true;
+}
+
+void detail::wakeup() { state().wakeup = ticks(); }
+
+void detail::mark_read() { state().read = ticks(); }
+
+void detail::begin_request() {
+    ThreadState& s = state();
+    s.current = {};
+    s.current.stamps[kWakeup] = s.wakeup;
+    s.current.stamps[kRead] = s.read;
+}
+
+void detail::mark(Phase phase) { state().current.stamps[phase] = ticks(); }
+
+void detail::end_request(uint64_t request_id) {
+    ThreadState& s = state();
+    if (s.pending_count == kMaxPending) {
+        commit();
+    }
+    s.current.request_id = request_id;
+    s.pending[s.pending_count++] = s.current;
+}
+
+void detail::commit() {
+    ThreadState& s = state();
+    if (s.pending_count == 0) return;
+
+    uint64_t now = ticks();
+    Ring& ring = *s.ring;
+    for (size_t i = 0; i < s.pending_count; i++) {
+        Slot& slot = ring.slots[ring.head++ & (kRingSize - 1)];
+        uint32_t version = slot.version.load(std::memory_order_relaxed);
+        slot.version.store(version + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        slot.record = s.pending[i];
+        slot.record.stamps[kSend] = now;
+
+        slot.version.store(version + 2, std::memory_order_release);
+    }
+    s.pending_count = 0;
+}
+
+long dump(const std::string& path) {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) return -1;
+
+    std::vector<Record> records;
+    {
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        for (const auto& ring : rings) {
+            for (size_t i = 0; i < kRingSize; i++) {
+                const Slot& slot = ring->slots[i];
+                uint32_t version = slot.version.load(std::memory_order_acquire);
+                if (version == 0 || (version & 1) != 0) continue;
+
+                Record record = slot.record;
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.version.load(std::memory_order_relaxed) != version) {
+                    continue;  // rewritten while we copied it
+                }
+                records.push_back(record);
+            }
+        }
+    }
+
+    std::sort(records.begin(), records.end(),
+              [](const Record& a, const Record& b) {
+                  return a.stamps[kWakeup] < b.stamps[kWakeup];
+              });
+
+    double scale = ns_per_tick();
+    out << "# request_id read parse route handler render send"
+           " (ns since wakeup, - if not reached)\n";
+    for (const Record& record : records) {
+        out << record.request_id;
+        for (int phase = kRead; phase < kPhaseCount; phase++) {
+            uint64_t stamp = record.stamps[phase];
+            if (stamp == 0 || record.stamps[kWakeup] == 0 ||
+                stamp < record.stamps[kWakeup]) {
+                out << " -";
+            } else {
+                out << ' '
+                    << std::llround(
+                           static_cast<double>(stamp -
+                                               record.stamps[kWakeup]) *
+                           scale);
+            }
+        }
+        out << '\n';
+    }
+    return static_cast<long>(records.size());
+}
+
+}  // namespace brick::trace
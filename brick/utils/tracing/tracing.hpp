@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+// USDT tracepoint `brick:<name>`: a single nop until bpftrace/perf attaches
+#define BRICK_PROBE(name, ...) STAP_PROBEV(brick, name, __VA_ARGS__)
+#else
+#define BRICK_PROBE(name, ...) ((void)0)
+#endif
+
+/**
+ * Per-request phase timestamps, for finding where the time of slow requests
+ * went.
+ *
+ * Each worker stamps the phases of the requests it serves with the TSC and
+ * appends finished records to its own fixed-size ring buffer (the oldest
+ * records are overwritten), so recording takes no locks and no syscalls.
+ * `dump` writes the latest records of every worker to a file; it can run at
+ * any time, from any thread.
+ *
+ * Recording is off until `enable` is called, and every call below is then a
+ * single branch. The USDT probes (`BRICK_PROBE`) are independent of this and
+ * compile to nothing when <sys/sdt.h> is not available.
+ *
+ * Usage (on a worker thread):
+ *       brick::trace::wakeup();              // epoll_wait returned
+ *       brick::trace::mark_read();           // socket read
+ *       brick::trace::begin_request();       // per request...
+ *       brick::trace::mark(brick::trace::kParse);
+ *       brick::trace::end_request(request_id);
+ *       brick::trace::commit();              // event done: responses sent
+ */
+
+namespace brick::trace {
+
+enum Phase : uint8_t {
+    kWakeup,   // `epoll_wait` returned
+    kRead,     // request bytes read from the socket
+    kParse,    // request parsed
+    kRoute,    // handler looked up
+    kHandler,  // handler returned
+    kRender,   // response rendered into the output buffer
+    kSend,     // output written to the socket
+    kPhaseCount
+};
+
+/**
+ * @brief Whether recording is on (set by `enable`; don't modify directly)
+ */
+extern bool active;
+
+/**
+ * @brief Turn recording on (call before worker threads start)
+ */
+void enable();
+
+/**
+ * @brief Current timestamp (TSC ticks where available)
+ */
+inline uint64_t ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+/**
+ * @brief Write the buffered records of all workers to `path`, one request
+ * per line with each phase in nanoseconds since the wakeup
+ * @return number of records written, or -1 if `path` can't be written
+ */
+long dump(const std::string& path);
+
+namespace detail {
+void wakeup();
+void mark_read();
+void begin_request();
+void mark(Phase phase);
+void end_request(uint64_t request_id);
+void commit();
+}  // namespace detail
+
+/**
+ * @brief Stamp the calling worker's wakeup (applies to the requests of the
+ * events that follow)
+ */
+inline void wakeup() {
+    if (active) detail::wakeup();
+}
+
+/**
+ * @brief Stamp the end of a socket read (applies to the requests parsed from
+ * it)
+ */
+inline void mark_read() {
+    if (active) detail::mark_read();
+}
+
+/**
+ * @brief Start a record for a new request
+ */
+inline void begin_request() {
+    if (active) detail::begin_request();
+}
+
+/**
+ * @brief Stamp a phase of the current request
+ */
+inline void mark(Phase phase) {
+    if (active) detail::mark(phase);
+}
+
+/**
+ * @brief Finish the current request's record (it is kept until `commit`)
+ */
+inline void end_request(uint64_t request_id) {
+    if (active) detail::end_request(request_id);
+}
+
+/**
+ * @brief Stamp `kSend` on the finished records and move them to the ring
+ */
+inline void commit() {
+    if (active) detail::commit();
+}
+
+}  // namespace brick::trace
@@ -0,0 +1,31 @@
+#include "brick/server/server.hpp"
+#include "brick/request/request.hpp"
+#include "brick/response/response.hpp"
+#include "brick/tls/tls.hpp"
+
+// Serves HTTPS (HTTP/1.1 and HTTP/2 via ALPN) on 3443 and plain HTTP on 3000.
+// Create a self-signed certificate first:
+//
+//   openssl req -x509 -newkey rsa:2048 -nodes -days 365 -subj /CN=localhost
+//       -keyout key.pem -out cert.pem   (one line)
+//
+// then try `curl -k https://localhost:3443/` or add `--http2`.
+
+brick::Response hello_world(const brick::Request&) {
+    brick::Response t{200};
+    t.set_body("Hello, World!");
+    return t;
+}
+
+int main() {
+    auto a = brick::Server(8);
+
+    brick::tls::TlsOptions options;
+    options.certificate_file = "cert.pem";
+    options.private_key_file = "key.pem";
+    a.enable_tls(options);
+
+    a.route("/", "GET", hello_world);
+    a.listen_tls(3443);
+    a.start(3000);
+}
@@ -0,0 +1,41 @@
+#include "brick/json/value.hpp"
+#include "brick/json/writer.hpp"
+#include "brick/request/request.hpp"
+#include "brick/response/response.hpp"
+#include "brick/server/server.hpp"
+
+// POST /order {"customer": {"name": "Ada"}, "items": [{"price": 2.5,
+// "quantity": 4}, ...]}
+brick::Response order(const brick::Request& request) {
+    auto body = brick::json::Value::parse(request.body_view());
+    std::optional<std::string> name = body["customer"]["name"].as_string();
+    if (!name) {
+        brick::Response response(400);
+        brick::json::Writer(response).begin_object().member(
+            "error", "customer.name is required").end_object();
+        return response;
+    }
+
+    double total = 0;
+    int64_t count = 0;
+    for (brick::json::Value item : body["items"].items()) {
+        total += item["price"].as_double().value_or(0) *
+                 static_cast<double>(item["quantity"].as_int().value_or(1));
+        count++;
+    }
+
+    brick::Response response(200);
+    brick::json::Writer json(response);
+    json.begin_object()
+        .member("customer", *name)
+        .member("items", count)
+        .member("total", total)
+        .end_object();
+    return response;
+}
+
+int main() {
+    brick::Server server(4);
+    server.route("/order", "POST", order);
+    server.start(3000);
+}
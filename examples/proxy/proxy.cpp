@@ -0,0 +1,35 @@
+#include "brick/server/server.hpp"
+#include "brick/server/proxy.hpp"
+#include "brick/server/rate_limiter.hpp"
+#include "brick/request/request.hpp"
+#include "brick/response/response.hpp"
+
+#include <memory>
+
+// Edge router on 3100: `/` and `/mirror` are forwarded to two backends.
+// Any HTTP server works as a stand-in, e.g. two copies of the hello_world
+// example moved to ports 3001 and 3002, or `python3 -m http.server 3001`.
+// Each client may make 100 requests per second per route, in bursts of 200.
+
+brick::Response health(const brick::Request&) {
+    brick::Response t{200};
+    t.set_body("ok");
+    return t;
+}
+
+int main() {
+    auto a = brick::Server(8);
+
+    brick::RateLimiter limiter({100, 200},
+                               brick::RateLimiter::Scope::kClientAndRoute);
+    a.use(limiter.middleware());
+
+    auto backends = std::make_shared<brick::Proxy>();
+    backends->add_tcp("127.0.0.1", 3001);
+    backends->add_tcp("127.0.0.1", 3002);
+
+    a.route("/", "GET", backends);
+    a.route("/mirror", "POST", backends);
+    a.route("/health", "GET", health);
+    a.start(3100);
+}
@@ -0,0 +1,190 @@
+// Convert binary access-log segments (see brick/access_log/format.hpp) to
+// text or CSV.
+//
+// usage: access_log_dump [--csv] SEGMENT...
+//
+// Segments are printed in the order given; live (".open") segments can be
+// read too, up to the last complete record.
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "brick/access_log/format.hpp"
+
+namespace al = brick::access_log;
+
+namespace {
+
+std::string format_time(int64_t ns) {
+    time_t seconds = static_cast<time_t>(ns / 1000000000);
+    struct tm tm;
+    gmtime_r(&seconds, &tm);
+    char buf[64];
+    size_t length = strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
+    snprintf(buf + length, sizeof(buf) - length, ".%06ldZ",
+             static_cast<long>(ns % 1000000000 / 1000));
+    return buf;
+}
+
+std::string format_peer(const uint8_t (&peer)[16]) {
+    static constexpr uint8_t kV4Mapped[12] = {0, 0, 0, 0, 0,    0,
+                                              0, 0, 0, 0, 0xff, 0xff};
+    static constexpr uint8_t kZero[16] = {};
+    if (memcmp(peer, kZero, sizeof(kZero)) == 0) return "unix";
+
+    char buf[INET6_ADDRSTRLEN];
+    const char* text =
+        memcmp(peer, kV4Mapped, sizeof(kV4Mapped)) == 0
+            ? inet_ntop(AF_INET, peer + 12, buf, sizeof(buf))
+            : inet_ntop(AF_INET6, peer, buf, sizeof(buf));
+    return text != nullptr ? text : "-";
+}
+
+std::string format_flags(uint8_t flags, char separator) {
+    std::string out;
+    auto add = [&](uint8_t flag, const char* name) {
+        if ((flags & flag) == 0) return;
+        if (!out.empty()) out += separator;
+        out += name;
+    };
+    add(al::kTls, "tls");
+    add(al::kHttp2, "h2");
+    add(al::kProxied, "proxied");
+    add(al::kTruncated, "truncated");
+    return out.empty() ? "-" : out;
+}
+
+std::string csv_field(std::string_view value) {
+    if (value.find_first_of(",\"\r\n") == std::string_view::npos) {
+        return std::string(value);
+    }
+    std::string out = "\"";
+    for (char c : value) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    return out + '"';
+}
+
+// print one segment; returns false if it can't be read
+bool dump(const char* path, bool csv) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << path << ": " << strerror(errno) << "\n";
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 ||
+        static_cast<size_t>(st.st_size) < sizeof(al::SegmentHeader)) {
+        std::cerr << path << ": not an access log segment\n";
+        close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void* base = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        std::cerr << path << ": " << strerror(errno) << "\n";
+        return false;
+    }
+
+    const auto* header = static_cast<const al::SegmentHeader*>(base);
+    if (memcmp(header->magic, al::kMagic, sizeof(al::kMagic)) != 0 ||
+        header->version != al::kVersion ||
+        header->record_size != sizeof(al::Record) ||
+        header->records_offset > size ||
+        sizeof(al::SegmentHeader) + header->routes_size >
+            header->records_offset) {
+        std::cerr << path << ": not an access log segment (or an unsupported "
+                             "version)\n";
+        munmap(base, size);
+        return false;
+    }
+
+    // "METHOD /path" names; only the path is printed
+    std::vector<std::string_view> routes;
+    std::string_view table(reinterpret_cast<const char*>(header + 1),
+                           header->routes_size);
+    while (!table.empty() && routes.size() < header->route_count) {
+        size_t end = std::min(table.find('\0'), table.size());
+        std::string_view name = table.substr(0, end);
+        size_t space = name.find(' ');
+        routes.push_back(space == std::string_view::npos
+                             ? name
+                             : name.substr(space + 1));
+        table.remove_prefix(std::min(end + 1, table.size()));
+    }
+
+    uint64_t count = std::min<uint64_t>(
+        {header->count.load(std::memory_order_acquire), header->capacity,
+         (size - header->records_offset) / sizeof(al::Record)});
+    const auto* records = reinterpret_cast<const al::Record*>(
+        static_cast<const char*>(base) + header->records_offset);
+
+    for (uint64_t i = 0; i < count; i++) {
+        const al::Record& record = records[i];
+        std::string_view route =
+            record.route > 0 && record.route <= routes.size()
+                ? routes[record.route - 1]
+                : "-";
+        std::string_view method = al::method_name(record.method);
+        if (csv) {
+            std::cout << format_time(record.timestamp_ns) << ','
+                      << header->worker << ',' << record.request_id << ','
+                      << format_peer(record.peer) << ',' << method << ','
+                      << csv_field(route) << ',' << record.status << ','
+                      << record.bytes << ',' << record.latency_us << ','
+                      << format_flags(record.flags, ';') << '\n';
+        } else {
+            std::cout << format_time(record.timestamp_ns) << " w"
+                      << header->worker << ' ' << format_peer(record.peer)
+                      << ' ' << method << ' ' << route << ' '
+                      << record.status << ' ' << record.bytes << ' '
+                      << record.latency_us << "us " << record.request_id
+                      << ' ' << format_flags(record.flags, ',') << '\n';
+        }
+    }
+
+    munmap(base, size);
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    bool csv = false;
+    std::vector<const char*> paths;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--csv") == 0) {
+            csv = true;
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (paths.empty()) {
+        std::cerr << "usage: " << argv[0] << " [--csv] SEGMENT...\n";
+        return 2;
+    }
+
+    if (csv) {
+        std::cout << "timestamp,worker,request_id,peer,method,route,status,"
+                     "bytes,latency_us,flags\n";
+    }
+    bool ok = true;
+    for (const char* path : paths) {
+        ok = dump(path, csv) && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,73 @@
+// Server for load_gen runs, with every socket tuning knob on the command
+// line so each can be measured against the kernel defaults.
+//
+// usage: bench_server [--threads N] [--body BYTES] [--nodelay] [--quickack]
+//                     [--defer-accept SECONDS] [--fastopen QUEUE]
+//                     [--busy-poll US] [--rcvbuf BYTES] [--sndbuf BYTES]
+//                     PORT
+//
+// Serves GET / with a body of `--body` bytes (default 13).
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+#include "brick/request/request.hpp"
+#include "brick/response/response.hpp"
+#include "brick/server/server.hpp"
+#include "brick/server/socket_options.hpp"
+
+int main(int argc, char** argv) {
+    brick::SocketOptions options;
+    unsigned int threads = std::thread::hardware_concurrency();
+    size_t body_size = 13;
+    int port = 0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--nodelay") {
+            options.tcp_nodelay = true;
+        } else if (arg == "--quickack") {
+            options.tcp_quickack = true;
+        } else if (arg == "--threads" && has_value) {
+            threads = atoi(argv[++i]);
+        } else if (arg == "--body" && has_value) {
+            body_size = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--defer-accept" && has_value) {
+            options.defer_accept_seconds = atoi(argv[++i]);
+        } else if (arg == "--fastopen" && has_value) {
+            options.fastopen_queue = atoi(argv[++i]);
+        } else if (arg == "--busy-poll" && has_value) {
+            options.busy_poll_us = atoi(argv[++i]);
+        } else if (arg == "--rcvbuf" && has_value) {
+            options.receive_buffer = atoi(argv[++i]);
+        } else if (arg == "--sndbuf" && has_value) {
+            options.send_buffer = atoi(argv[++i]);
+        } else if (arg[0] != '-' && port == 0) {
+            port = atoi(arg.c_str());
+        } else {
+            port = 0;
+            break;
+        }
+    }
+    if (port <= 0 || threads == 0) {
+        fprintf(stderr,
+                "usage: %s [--threads N] [--body BYTES] [--nodelay] "
+                "[--quickack] [--defer-accept SECONDS] [--fastopen QUEUE] "
+                "[--busy-poll US] [--rcvbuf BYTES] [--sndbuf BYTES] PORT\n",
+                argv[0]);
+        return 2;
+    }
+
+    std::string body(body_size, 'x');
+    brick::Server server(threads);
+    server.set_socket_options(options);
+    server.route("/", "GET", [&body](const brick::Request&) {
+        brick::Response response(200);
+        response.set_body(body);
+        return response;
+    });
+    server.start(port);
+}
@@ -0,0 +1,212 @@
+// Closed-loop HTTP/1.1 load generator, for measuring the server's socket
+// and output tuning (see brick/server/socket_options.hpp).
+//
+// usage: load_gen [--connections N] [--seconds N] [--pipeline N] [--close]
+//                 [--path PATH] PORT
+//
+// Each connection runs on its own thread: it sends `--pipeline` GETs, waits
+// for all of their responses, and repeats. With `--close` every request
+// opens a new connection (and asks the server to close it), which measures
+// connection setup instead. Prints the request rate and latency percentiles.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    int port = 0;
+    int connections = 16;
+    int seconds = 10;
+    int pipeline = 1;
+    bool close = false;
+    std::string path = "/";
+};
+
+struct Result {
+    uint64_t requests = 0;
+    uint64_t errors = 0;
+    // microseconds from sending a batch to each of its responses
+    std::vector<uint32_t> latencies;
+};
+
+int connect_to(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    int opt = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) <
+        0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool send_all(int fd, std::string_view data) {
+    while (!data.empty()) {
+        ssize_t n = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        data.remove_prefix(n);
+    }
+    return true;
+}
+
+// length of the first complete response in `in`, or 0 if there is none yet
+size_t response_length(std::string_view in) {
+    size_t end = in.find("\r\n\r\n");
+    if (end == std::string_view::npos) return 0;
+
+    size_t body = 0;
+    std::string_view head = in.substr(0, end);
+    size_t line = 0;
+    while ((line = head.find("\r\n", line)) != std::string_view::npos) {
+        line += 2;
+        std::string_view name = head.substr(line, 15);
+        if (name.size() == 15 &&
+            strncasecmp(name.data(), "content-length:", 15) == 0) {
+            body = strtoull(head.data() + line + 15, nullptr, 10);
+        }
+    }
+    size_t total = end + 4 + body;
+    return in.size() >= total ? total : 0;
+}
+
+void run(const Options& options, Clock::time_point deadline, Result* result) {
+    std::string request = "GET " + options.path +
+                          " HTTP/1.1\r\nHost: localhost\r\n" +
+                          (options.close ? "Connection: close\r\n" : "") +
+                          "\r\n";
+    std::string batch;
+    for (int i = 0; i < options.pipeline; i++) batch += request;
+
+    std::string in;
+    char buf[64 * 1024];
+    int fd = -1;
+    while (Clock::now() < deadline) {
+        if (fd < 0 && (fd = connect_to(options.port)) < 0) {
+            result->errors++;
+            continue;
+        }
+
+        Clock::time_point sent = Clock::now();
+        bool ok = send_all(fd, batch);
+        int pending = options.pipeline;
+        in.clear();
+        while (ok && pending > 0) {
+            size_t length;
+            while (pending > 0 && (length = response_length(in)) > 0) {
+                in.erase(0, length);
+                pending--;
+                result->requests++;
+                result->latencies.push_back(static_cast<uint32_t>(
+                    std::chrono::duration_cast<std::chrono::microseconds>(
+                        Clock::now() - sent)
+                        .count()));
+            }
+            if (pending == 0) break;
+            ssize_t n = recv(fd, buf, sizeof(buf), 0);
+            ok = n > 0;
+            if (ok) in.append(buf, n);
+        }
+
+        if (!ok) result->errors++;
+        if (!ok || options.close) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    if (fd >= 0) close(fd);
+}
+
+bool parse(int argc, char** argv, Options* options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--close") {
+            options->close = true;
+        } else if (arg == "--connections" && has_value) {
+            options->connections = atoi(argv[++i]);
+        } else if (arg == "--seconds" && has_value) {
+            options->seconds = atoi(argv[++i]);
+        } else if (arg == "--pipeline" && has_value) {
+            options->pipeline = atoi(argv[++i]);
+        } else if (arg == "--path" && has_value) {
+            options->path = argv[++i];
+        } else if (arg[0] != '-' && options->port == 0) {
+            options->port = atoi(arg.c_str());
+        } else {
+            return false;
+        }
+    }
+    if (options->close) options->pipeline = 1;
+    return options->port > 0 && options->connections > 0 &&
+           options->seconds > 0 && options->pipeline > 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse(argc, argv, &options)) {
+        fprintf(stderr,
+                "usage: %s [--connections N] [--seconds N] [--pipeline N] "
+                "[--close] [--path PATH] PORT\n",
+                argv[0]);
+        return 2;
+    }
+
+    Clock::time_point deadline =
+        Clock::now() + std::chrono::seconds(options.seconds);
+    std::vector<Result> results(options.connections);
+    std::vector<std::thread> threads;
+    for (Result& result : results) {
+        threads.emplace_back(run, std::cref(options), deadline, &result);
+    }
+    for (std::thread& thread : threads) thread.join();
+
+    Result total;
+    for (Result& result : results) {
+        total.requests += result.requests;
+        total.errors += result.errors;
+        total.latencies.insert(total.latencies.end(),
+                               result.latencies.begin(),
+                               result.latencies.end());
+    }
+    std::sort(total.latencies.begin(), total.latencies.end());
+    auto percentile = [&](double p) -> uint32_t {
+        if (total.latencies.empty()) return 0;
+        return total.latencies[static_cast<size_t>(
+            p * (total.latencies.size() - 1))];
+    };
+
+    printf("%llu requests, %llu errors, %.0f req/s, latency p50 %u us, "
+           "p99 %u us, max %u us\n",
+           static_cast<unsigned long long>(total.requests),
+           static_cast<unsigned long long>(total.errors),
+           static_cast<double>(total.requests) / options.seconds,
+           percentile(0.5), percentile(0.99), percentile(1.0));
+    return total.requests > 0 ? 0 : 1;
+}